@@ -0,0 +1,392 @@
+/* Copyright © 2026 Jakub Wilk <jwilk@jwilk.net>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "autoconf.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "batch.h"
+#include "config.h"
+#include "io.h"
+#include "libnonogram.h"
+#include "memory.h"
+#include "nonogram.h"
+#include "output.h"
+#include "timer.h"
+
+static char **gfiles;
+static unsigned int gnfiles, gfilescap;
+
+static pthread_mutex_t glock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gcond = PTHREAD_COND_INITIALIZER;
+static Job *gjobs; // ring buffer of jobs that are read but not printed yet
+static size_t gwindow;
+static size_t gnread, gntaken, gnprinted;
+static bool geof;
+static bool gfailed;
+static bool gmultiple;
+static bool gstopped;
+static const volatile sig_atomic_t *ginterrupted;
+static const volatile sig_atomic_t *gprogress;
+static nonogram_store *gstore;
+
+static void report_error(const char *path)
+{
+  fprintf(stderr, "%s: %s: %s\n", PACKAGE_NAME, path, strerror(errno));
+  gfailed = true;
+}
+
+static void add_file(const char *path, size_t len)
+{
+  if (gnfiles == gfilescap)
+  {
+    gfilescap = gfilescap > 0 ? 2 * gfilescap : 64;
+    gfiles = reallocate(gfiles, gfilescap * sizeof(char*));
+  }
+  gfiles[gnfiles] = alloc(len + 1);
+  memcpy(gfiles[gnfiles], path, len);
+  gnfiles++;
+}
+
+static int compare_names(const void *a, const void *b)
+{
+  return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+static void add_directory(const char *path)
+// Add all the *.nin files from the directory, in alphabetical order.
+{
+  DIR *dir;
+  struct dirent *entry;
+  size_t len, plen = strlen(path);
+  unsigned int first = gnfiles;
+  char *name;
+
+  dir = opendir(path);
+  if (dir == NULL)
+  {
+    report_error(path);
+    return;
+  }
+  while ((entry = readdir(dir)) != NULL)
+  {
+    len = strlen(entry->d_name);
+    if (len <= 4 || strcmp(entry->d_name + len - 4, ".nin") != 0)
+      continue;
+    name = alloc(plen + len + 2);
+    memcpy(name, path, plen);
+    name[plen] = '/';
+    memcpy(name + plen + 1, entry->d_name, len);
+    add_file(name, plen + len + 1);
+    free(name);
+  }
+  closedir(dir);
+  qsort(gfiles + first, gnfiles - first, sizeof(char*), compare_names);
+}
+
+static void add_path(const char *path);
+
+static void add_list(const char *path)
+// Add the paths listed in the file, one per line.
+{
+  FILE *file;
+  char c, *buffer = NULL;
+  size_t len = 0, size = 0;
+
+  file = fopen(path, "r");
+  if (file == NULL)
+  {
+    report_error(path);
+    return;
+  }
+  do
+  {
+    c = freadchar(file);
+    if (c == '\n' || c == '\0')
+    {
+      while (len > 0 && buffer[len - 1] == '\r')
+        len--;
+      if (len > 0)
+      {
+        buffer[len] = '\0';
+        add_path(buffer);
+      }
+      len = 0;
+      continue;
+    }
+    if (len + 1 >= size)
+    {
+      size = size > 0 ? 2 * size : 256;
+      buffer = reallocate(buffer, size);
+    }
+    buffer[len++] = c;
+  }
+  while (c != '\0');
+  free(buffer);
+  fclose(file);
+}
+
+static void add_path(const char *path)
+// Add the file, the *.nin files in the directory,
+// or the files listed in the file (if the path starts with "@").
+{
+  struct stat st;
+
+  if (path[0] == '@')
+    add_list(path + 1);
+  else if (strcmp(path, "-") != 0 && stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+    add_directory(path);
+  else
+    add_file(path, strlen(path));
+}
+
+static void report_progress(const nonogram_progress *progress, void *data)
+{
+  const Job *job = data;
+  print_progress(job->name, job->line, progress);
+}
+
+static void solve_job(nonogram_solver *solver, Job *job)
+{
+  const nonogram_puzzle *puzzle = job->puzzle;
+  size_t size = nonogram_puzzle_width(puzzle) * nonogram_puzzle_height(puzzle) * sizeof(bit);
+
+  nonogram_set_progress(solver, config.progress, gprogress, report_progress, job);
+  job->result = nonogram_solve(solver, puzzle);
+  if (job->result != NONOGRAM_INCONSISTENT)
+  {
+    job->bits = alloc(size);
+    nonogram_get_picture(solver, job->bits);
+  }
+  if (job->result == NONOGRAM_MULTIPLE)
+  {
+    job->bits2 = alloc(size);
+    nonogram_get_second_picture(solver, job->bits2);
+  }
+  nonogram_get_stats(solver, &job->stats);
+}
+
+static void *run_jobs(void *arg)
+// Solve jobs in the order they were read, until there are no more.
+// The solver (and its buffers) is reused for all of them.
+{
+  nonogram_solver *solver = nonogram_solver_create(config.threads);
+  Job *job;
+
+  nonogram_set_unique(solver, config.unique);
+  nonogram_set_limits(solver, config.time_limit, config.node_limit, config.memory_limit);
+  nonogram_set_interrupt(solver, ginterrupted);
+  nonogram_set_store(solver, gstore);
+  (void)arg;
+  pthread_mutex_lock(&glock);
+  while (true)
+  {
+    while (gntaken == gnread && !geof)
+      pthread_cond_wait(&gcond, &glock);
+    if (gntaken == gnread)
+      break;
+    job = gjobs + gntaken++ % gwindow;
+    if (job->done)
+      continue; // invalid input; the slot may be reused as soon as it's printed
+    pthread_mutex_unlock(&glock);
+    solve_job(solver, job);
+    pthread_mutex_lock(&glock);
+    job->done = true;
+    pthread_cond_broadcast(&gcond);
+  }
+  pthread_mutex_unlock(&glock);
+  nonogram_solver_destroy(solver);
+  return NULL;
+}
+
+static void print_job(Job *job)
+{
+  double t = get_time();
+  bool solved = job->puzzle != NULL && job->result != NONOGRAM_INCONSISTENT && job->result != NONOGRAM_STOPPED;
+
+  if (job->puzzle == NULL)
+    printf("%s:%u: invalid input\n", job->name, job->line);
+  else if (job->result == NONOGRAM_STOPPED)
+  {
+    printf("%s:%u: %s\n", job->name, job->line, config.unique ? "unknown" : "stopped");
+    print_picture(job->puzzle, job->bits, NULL);
+  }
+  else if (!solved)
+    printf("%s:%u: %s\n", job->name, job->line, config.unique ? "none" : "inconsistent");
+  else
+  {
+    printf("%s:%u: %s\n", job->name, job->line,
+      !config.unique ? "solved" : job->result == NONOGRAM_MULTIPLE ? "multiple" : "unique");
+    print_picture(job->puzzle, job->bits, NULL);
+    if (job->bits2 != NULL)
+      print_picture(job->puzzle, job->bits2, NULL);
+  }
+  if (config.stats && job->puzzle != NULL)
+    print_stats(job->name, job->line, solved, &job->stats, job->parsetime, get_time() - t);
+  if (job->puzzle != NULL && job->result == NONOGRAM_STOPPED)
+    gstopped = true;
+  else if (!solved)
+    gfailed = true;
+  else if (job->result == NONOGRAM_MULTIPLE)
+    gmultiple = true;
+  if (job->puzzle != NULL)
+    nonogram_free_puzzle(job->puzzle);
+  free(job->bits);
+  free(job->bits2);
+}
+
+static void flush_jobs(size_t maxpending)
+// Print finished jobs in the input order,
+// waiting for them until at most maxpending are left.
+{
+  Job *job;
+
+  pthread_mutex_lock(&glock);
+  while (gnprinted < gnread)
+  {
+    job = gjobs + gnprinted % gwindow;
+    if (!job->done)
+    {
+      if (gnread - gnprinted <= maxpending)
+        break;
+      pthread_cond_wait(&gcond, &glock);
+      continue;
+    }
+    pthread_mutex_unlock(&glock);
+    print_job(job);
+    pthread_mutex_lock(&glock);
+    gnprinted++;
+  }
+  pthread_mutex_unlock(&glock);
+}
+
+static void read_jobs(const char *name)
+// Read puzzles from the file, and queue them for solving.
+// Like in the normal mode, anything after the first puzzle in a file is ignored,
+// but stdin may contain any number of puzzles.
+{
+  int fd;
+  nonogram_reader *reader;
+  Job *job;
+  bool stream = strcmp(name, "-") == 0;
+  double t;
+
+  if (stream)
+    fd = STDIN_FILENO;
+  else
+    fd = open(name, O_RDONLY);
+  if (fd < 0)
+  {
+    report_error(name);
+    return;
+  }
+  reader = nonogram_open_fd(fd);
+  while (true)
+  {
+    flush_jobs(gwindow - 1);
+    job = gjobs + gnread % gwindow;
+    memset(job, 0, sizeof(Job));
+    job->name = name;
+    t = get_time();
+    job->puzzle = nonogram_read_puzzle(reader, &job->line);
+    job->parsetime = get_time() - t;
+    if (job->puzzle == NULL && job->line == 0)
+      break;
+    pthread_mutex_lock(&glock);
+    job->done = job->puzzle == NULL;
+    gnread++;
+    pthread_cond_broadcast(&gcond);
+    pthread_mutex_unlock(&glock);
+    if (job->puzzle == NULL)
+      break; // there's no telling where the next puzzle starts
+    if (!stream || *ginterrupted)
+      break;
+  }
+  nonogram_close_reader(reader);
+  if (fd != STDIN_FILENO)
+    close(fd);
+}
+
+int run_batch(char **paths, unsigned int npaths, nonogram_store *store, const volatile sig_atomic_t *interrupted, const volatile sig_atomic_t *progress)
+// Solve all puzzles from the given files (or from stdin, if there are none),
+// using a pool of config.jobs threads.
+// Results are printed in the input order, each preceded by a status line.
+// Once *interrupted is nonzero, the solvers give up, and no more files are read.
+// Whenever *progress changes, the solvers report their progress.
+// Solutions are looked up in, and added to, the store, unless it's NULL.
+{
+  pthread_t *threads;
+  unsigned int k;
+  int rc;
+
+  ginterrupted = interrupted;
+  gprogress = progress;
+  gstore = store;
+  if (npaths == 0)
+    add_path("-");
+  for (k = 0; k < npaths; k++)
+    add_path(paths[k]);
+
+  gwindow = 4 * config.jobs;
+  gjobs = alloc(gwindow * sizeof(Job));
+  threads = alloc(config.jobs * sizeof(pthread_t));
+  for (k = 0; k < config.jobs; k++)
+  {
+    rc = pthread_create(threads + k, NULL, run_jobs, NULL);
+    if (rc != 0)
+    {
+      errno = rc;
+      perror(PACKAGE_NAME);
+      abort();
+    }
+  }
+
+  for (k = 0; k < gnfiles && !*ginterrupted; k++)
+    read_jobs(gfiles[k]);
+
+  pthread_mutex_lock(&glock);
+  geof = true;
+  pthread_cond_broadcast(&gcond);
+  pthread_mutex_unlock(&glock);
+  flush_jobs(0);
+  for (k = 0; k < config.jobs; k++)
+    pthread_join(threads[k], NULL);
+
+  free(threads);
+  free(gjobs);
+  for (k = 0; k < gnfiles; k++)
+    free(gfiles[k]);
+  free(gfiles);
+  return gfailed ? EXIT_FAILURE : gstopped ? EXIT_STOPPED : gmultiple ? EXIT_MULTIPLE : EXIT_SUCCESS;
+}
+
+/* vim:set ts=2 sts=2 sw=2 et: */
@@ -0,0 +1,48 @@
+/* Copyright © 2026 Jakub Wilk <jwilk@jwilk.net>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef NONOGRAM_BATCH_H
+#define NONOGRAM_BATCH_H
+
+#include <signal.h>
+#include <stdbool.h>
+
+#include "libnonogram.h"
+#include "nonogram.h"
+
+typedef struct
+{
+  const char *name;        // the file the puzzle comes from
+  unsigned int line;       // where the puzzle starts, or where the input is invalid
+  nonogram_puzzle *puzzle; // NULL if the input is invalid
+  nonogram_result result;
+  bit *bits;               // the solution, or what is known of it if the solver gave up
+  bit *bits2;              // the second solution, if --unique found one
+  nonogram_stats stats;
+  double parsetime;
+  bool done;
+} Job;
+
+int run_batch(char**, unsigned int, nonogram_store*, const volatile sig_atomic_t*, const volatile sig_atomic_t*);
+
+#endif
+
+/* vim:set ts=2 sts=2 sw=2 et: */
@@ -0,0 +1,641 @@
+/* Copyright © 2026 Jakub Wilk <jwilk@jwilk.net>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* The benchmark driver.
+ *
+ * Every puzzle is solved a few times, each time in a fresh child process, so
+ * that its CPU time and peak RSS can be measured on their own. The best wall
+ * and CPU times are reported, together with the solver statistics of the last
+ * run. The solution is checked against the golden one.
+ *
+ * Results are written as CSV or JSON. A CSV file from an earlier run can be
+ * given as the baseline; anything that got worse by more than the threshold
+ * is reported as a regression.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "autoconf.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <math.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "libnonogram.h"
+
+#define EXIT_INVALID 3 // what a child exits with if the input is invalid
+
+typedef struct
+{
+  nonogram_result result;
+  double wall, cpu; // seconds
+  double maxrss;    // KiB
+  nonogram_stats stats;
+  unsigned int width, height;
+} Report; // what a child sends back, followed by the cells
+
+typedef enum
+{
+  ST_OK,           // the solution is the golden one
+  ST_ALT,          // another solution, which agrees with the clues
+  ST_UNCHECKED,    // solved, but there's no golden solution
+  ST_WRONG,
+  ST_INCONSISTENT, // the solver found no solution
+  ST_INVALID,      // the input is invalid
+  ST_TIMEOUT,
+  ST_CRASH
+} Status;
+
+static const char *status_names[] = {
+  "ok", "alt", "unchecked", "wrong", "inconsistent", "invalid", "timeout", "crash"
+};
+
+typedef struct
+{
+  char *name;
+  double wall, cpu;     // seconds
+  double fingercounter, nodes;
+  double maxrss;        // KiB
+} Baseline;
+
+static unsigned int gruns = 3;
+static unsigned int gthreads = 1;
+static unsigned int gtimeout = 60;
+static double gthreshold = 10.0; // percent
+static double gnoise = 0.002;    // seconds; time differences below this are ignored
+static bool gjson = false;
+static FILE *ggolden = NULL;
+static FILE *gnewgolden = NULL;
+static Baseline *gbaseline = NULL;
+static unsigned int gnbaseline = 0;
+
+static void show_usage(FILE *file)
+{
+  fprintf(file,
+    "Usage: bench [OPTIONS] FILE...\n\n"
+    "Options:\n"
+    "  -r N        solve every puzzle N times (default: 3)\n"
+    "  -t N        use N threads for backtracking (default: 1)\n"
+    "  -T SECONDS  give up on a puzzle after SECONDS (default: 60)\n"
+    "  -g FILE     check the solutions against the golden ones from FILE\n"
+    "  -w FILE     write the solutions to FILE, in the golden format\n"
+    "  -f FORMAT   output format: csv (default) or json\n"
+    "  -o FILE     write the results to FILE instead of stdout\n"
+    "  -b FILE     compare with the baseline CSV FILE\n"
+    "  -x PERCENT  regression threshold (default: 10)\n"
+    "  -h          show this help message and exit\n");
+}
+
+static void fail(const char *what)
+{
+  perror(what);
+  exit(EXIT_FAILURE);
+}
+
+static void *xalloc(size_t size)
+{
+  void *tmp = calloc(1, size > 0 ? size : 1);
+  if (tmp == NULL)
+    fail("bench");
+  return tmp;
+}
+
+static unsigned int parse_number(const char *arg, unsigned int min)
+{
+  unsigned long n;
+  char *end;
+
+  n = strtoul(arg, &end, 10);
+  if (*arg < '0' || *arg > '9' || *end != '\0' || n < min || n > 1000000)
+  {
+    fprintf(stderr, "bench: invalid number: %s\n", arg);
+    exit(EXIT_FAILURE);
+  }
+  return n;
+}
+
+static const char *base_name(const char *path)
+{
+  const char *slash = strrchr(path, '/');
+  return slash != NULL ? slash + 1 : path;
+}
+
+static double timespec_diff(const struct timespec *t0, const struct timespec *t1)
+{
+  return (t1->tv_sec - t0->tv_sec) + (t1->tv_nsec - t0->tv_nsec) / 1e9;
+}
+
+static void write_all(int fd, const void *buffer, size_t size)
+{
+  const char *p = buffer;
+  ssize_t n;
+
+  while (size > 0)
+  {
+    n = write(fd, p, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      _exit(EXIT_FAILURE);
+    p += n;
+    size -= n;
+  }
+}
+
+static nonogram_puzzle *load_puzzle(const char *path)
+// Read the puzzle from the file; return NULL if it's not there or invalid.
+{
+  int fd;
+  unsigned int where;
+  nonogram_reader *reader;
+  nonogram_puzzle *puzzle;
+
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return NULL;
+  reader = nonogram_open_fd(fd);
+  puzzle = nonogram_read_puzzle(reader, &where);
+  nonogram_close_reader(reader);
+  close(fd);
+  return puzzle;
+}
+
+static void run_child(const char *path, int fd)
+// Solve the puzzle and send the report through fd. Never returns.
+{
+  nonogram_puzzle *puzzle;
+  nonogram_solver *solver;
+  signed char *cells;
+  struct timespec t0, t1;
+  struct rusage usage;
+  Report report;
+
+  alarm(gtimeout);
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  puzzle = load_puzzle(path);
+  if (puzzle == NULL)
+    _exit(EXIT_INVALID);
+  solver = nonogram_solver_create(gthreads);
+  report.result = nonogram_solve(solver, puzzle);
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+  report.wall = timespec_diff(&t0, &t1);
+  report.width = nonogram_puzzle_width(puzzle);
+  report.height = nonogram_puzzle_height(puzzle);
+  nonogram_get_stats(solver, &report.stats);
+  cells = xalloc((size_t) report.width * report.height);
+  nonogram_get_picture(solver, cells);
+  getrusage(RUSAGE_SELF, &usage);
+  report.cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+             + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+  report.maxrss = usage.ru_maxrss;
+  write_all(fd, &report, sizeof report);
+  write_all(fd, cells, (size_t) report.width * report.height);
+  _exit(EXIT_SUCCESS);
+}
+
+static Status run_once(const char *path, Report *report, signed char **cells)
+// Solve the puzzle in a child process.
+// On success, *cells is set to a newly allocated copy of the picture.
+{
+  int fds[2], status;
+  pid_t pid;
+  char *buffer = NULL;
+  size_t size = 0, capacity = 0;
+  ssize_t n;
+
+  fflush(NULL);
+  if (pipe(fds) != 0)
+    fail("bench: pipe()");
+  pid = fork();
+  if (pid < 0)
+    fail("bench: fork()");
+  if (pid == 0)
+  {
+    close(fds[0]);
+    run_child(path, fds[1]);
+  }
+  close(fds[1]);
+  while (true)
+  {
+    if (size == capacity)
+    {
+      capacity = capacity > 0 ? 2 * capacity : 1 << 16;
+      buffer = realloc(buffer, capacity);
+      if (buffer == NULL)
+        fail("bench");
+    }
+    n = read(fds[0], buffer + size, capacity - size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+    size += n;
+  }
+  close(fds[0]);
+  while (waitpid(pid, &status, 0) < 0)
+    if (errno != EINTR)
+      fail("bench: waitpid()");
+
+  *cells = NULL;
+  if (WIFSIGNALED(status))
+  {
+    free(buffer);
+    return WTERMSIG(status) == SIGALRM ? ST_TIMEOUT : ST_CRASH;
+  }
+  if (WEXITSTATUS(status) == EXIT_INVALID)
+  {
+    free(buffer);
+    return ST_INVALID;
+  }
+  if (WEXITSTATUS(status) != EXIT_SUCCESS || size < sizeof *report)
+  {
+    free(buffer);
+    return ST_CRASH;
+  }
+  memcpy(report, buffer, sizeof *report);
+  if (size != sizeof *report + (size_t) report->width * report->height)
+  {
+    free(buffer);
+    return ST_CRASH;
+  }
+  *cells = xalloc(size - sizeof *report);
+  memcpy(*cells, buffer + sizeof *report, size - sizeof *report);
+  free(buffer);
+  return report->result == NONOGRAM_SOLVED ? ST_UNCHECKED : ST_INCONSISTENT;
+}
+
+static signed char *find_golden(const char *name, unsigned int width, unsigned int height)
+// Look up the golden solution of the puzzle.
+//
+// The golden file consists of entries like this:
+//
+//   name width height
+//   ##..#
+//   .##..
+//
+// i.e. a header line followed by the rows of the picture.
+{
+  char *line = NULL;
+  size_t size = 0;
+  ssize_t len;
+  size_t namelen = strlen(name);
+  unsigned int w, h, i, j;
+  signed char *cells = NULL;
+
+  rewind(ggolden);
+  while ((len = getline(&line, &size, ggolden)) > 0)
+  {
+    if (strncmp(line, name, namelen) != 0 || line[namelen] != ' ')
+      continue;
+    if (sscanf(line + namelen, "%u %u", &w, &h) != 2 || w != width || h != height)
+      break;
+    cells = xalloc((size_t) width * height);
+    for (i = 0; i < height; i++)
+    {
+      len = getline(&line, &size, ggolden);
+      if (len < (ssize_t) width)
+        break;
+      for (j = 0; j < width; j++)
+        cells[i * width + j] = line[j] == '#' ? 1 : -1;
+    }
+    if (i < height)
+    {
+      free(cells);
+      cells = NULL;
+    }
+    break;
+  }
+  free(line);
+  return cells;
+}
+
+static bool check_solution(const char *path, const signed char *cells)
+// Check the picture against the clues.
+{
+  nonogram_puzzle *puzzle;
+  bool ok;
+
+  puzzle = load_puzzle(path);
+  if (puzzle == NULL)
+    return false;
+  ok = nonogram_check_picture(puzzle, cells);
+  nonogram_free_puzzle(puzzle);
+  return ok;
+}
+
+static void write_golden(const char *name, const signed char *cells, unsigned int width, unsigned int height)
+{
+  unsigned int i, j;
+
+  fprintf(gnewgolden, "%s %u %u\n", name, width, height);
+  for (i = 0; i < height; i++)
+  {
+    for (j = 0; j < width; j++)
+      putc(cells[i * width + j] > 0 ? '#' : '.', gnewgolden);
+    putc('\n', gnewgolden);
+  }
+}
+
+static void load_baseline(const char *path)
+// Read a CSV file written by an earlier run.
+{
+  FILE *file;
+  char *line = NULL, *field, *save;
+  size_t size = 0;
+  unsigned int capacity = 0, k;
+  int columns[6] = { -1, -1, -1, -1, -1, -1 };
+  static const char *names[6] = { "name", "wall", "cpu", "fingercounter", "nodes", "maxrss" };
+  Baseline *entry;
+  int n;
+
+  file = fopen(path, "r");
+  if (file == NULL)
+    fail(path);
+  if (getline(&line, &size, file) > 0)
+    for (n = 0, field = strtok_r(line, ",\n", &save); field != NULL; n++, field = strtok_r(NULL, ",\n", &save))
+      for (k = 0; k < 6; k++)
+        if (strcmp(field, names[k]) == 0)
+          columns[k] = n;
+  for (k = 0; k < 6; k++)
+    if (columns[k] < 0)
+    {
+      fprintf(stderr, "bench: %s: no \"%s\" column\n", path, names[k]);
+      exit(EXIT_FAILURE);
+    }
+  while (getline(&line, &size, file) > 0)
+  {
+    if (gnbaseline == capacity)
+    {
+      capacity = capacity > 0 ? 2 * capacity : 256;
+      gbaseline = realloc(gbaseline, capacity * sizeof(Baseline));
+      if (gbaseline == NULL)
+        fail("bench");
+    }
+    entry = gbaseline + gnbaseline;
+    memset(entry, 0, sizeof(Baseline));
+    for (n = 0, field = strtok_r(line, ",\n", &save); field != NULL; n++, field = strtok_r(NULL, ",\n", &save))
+      if (n == columns[0])
+        entry->name = strdup(field);
+      else if (n == columns[1])
+        entry->wall = strtod(field, NULL);
+      else if (n == columns[2])
+        entry->cpu = strtod(field, NULL);
+      else if (n == columns[3])
+        entry->fingercounter = strtod(field, NULL);
+      else if (n == columns[4])
+        entry->nodes = strtod(field, NULL);
+      else if (n == columns[5])
+        entry->maxrss = strtod(field, NULL);
+    if (entry->name != NULL)
+      gnbaseline++;
+  }
+  free(line);
+  fclose(file);
+}
+
+static const Baseline *find_baseline(const char *name)
+{
+  unsigned int k;
+
+  for (k = 0; k < gnbaseline; k++)
+    if (strcmp(gbaseline[k].name, name) == 0)
+      return gbaseline + k;
+  return NULL;
+}
+
+static bool regressed(const char *name, const char *what, double old, double new, double noise)
+// Report a regression, if new is worse than old by more than the threshold.
+{
+  if (new - old <= noise || new <= old * (1 + gthreshold / 100))
+    return false;
+  if (old > 0)
+    fprintf(stderr, "%s: %s regressed: %g -> %g (%+.0f%%)\n", name, what, old, new, 100 * (new - old) / old);
+  else
+    fprintf(stderr, "%s: %s regressed: %g -> %g\n", name, what, old, new);
+  return true;
+}
+
+static void print_json_string(FILE *file, const char *s)
+{
+  putc('"', file);
+  for (; *s; s++)
+    if (*s == '"' || *s == '\\')
+      fprintf(file, "\\%c", *s);
+    else if ((unsigned char) *s < ' ')
+      fprintf(file, "\\u%04x", (unsigned int) *s);
+    else
+      putc(*s, file);
+  putc('"', file);
+}
+
+static void print_result(FILE *file, bool first, const char *name, Status status,
+  double wall, double cpu, const nonogram_stats *stats, double maxrss)
+{
+  if (gjson)
+  {
+    fprintf(file, "%s\n  {\"name\": ", first ? "[" : ",");
+    print_json_string(file, name);
+    fprintf(file,
+      ", \"status\": \"%s\", \"wall\": %.6f, \"cpu\": %.6f, "
+      "\"fingercounter\": %ju, \"nodes\": %ju, \"maxrss\": %.0f}",
+      status_names[status], wall, cpu, stats->fingercounter, stats->nodes, maxrss);
+  }
+  else
+  {
+    if (first)
+      fprintf(file, "name,status,wall,cpu,fingercounter,nodes,maxrss\n");
+    fprintf(file, "%s,%s,%.6f,%.6f,%ju,%ju,%.0f\n",
+      name, status_names[status], wall, cpu, stats->fingercounter, stats->nodes, maxrss);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  int opt, k;
+  unsigned int run, nfailures = 0, nregressions = 0;
+  const char *name;
+  FILE *output = stdout;
+  Status status;
+  Report report;
+  nonogram_stats stats;
+  signed char *cells, *golden;
+  double wall, cpu, maxrss;
+  double totalwall = 0, totalcpu = 0;
+  double basewall = 0, basecpu = 0, comparedwall = 0, comparedcpu = 0;
+  const Baseline *base;
+
+  while ((opt = getopt(argc, argv, "r:t:T:g:w:f:o:b:x:h")) != -1)
+  switch (opt)
+  {
+  case 'r':
+    gruns = parse_number(optarg, 1);
+    break;
+  case 't':
+    gthreads = parse_number(optarg, 1);
+    break;
+  case 'T':
+    gtimeout = parse_number(optarg, 1);
+    break;
+  case 'g':
+    ggolden = fopen(optarg, "r");
+    if (ggolden == NULL)
+      fail(optarg);
+    break;
+  case 'w':
+    gnewgolden = fopen(optarg, "w");
+    if (gnewgolden == NULL)
+      fail(optarg);
+    break;
+  case 'f':
+    if (strcmp(optarg, "json") == 0)
+      gjson = true;
+    else if (strcmp(optarg, "csv") == 0)
+      gjson = false;
+    else
+    {
+      fprintf(stderr, "bench: invalid format: %s\n", optarg);
+      return EXIT_FAILURE;
+    }
+    break;
+  case 'o':
+    output = fopen(optarg, "w");
+    if (output == NULL)
+      fail(optarg);
+    break;
+  case 'b':
+    load_baseline(optarg);
+    break;
+  case 'x':
+    gthreshold = parse_number(optarg, 0);
+    break;
+  case 'h':
+    show_usage(stdout);
+    return EXIT_SUCCESS;
+  default:
+    show_usage(stderr);
+    return EXIT_FAILURE;
+  }
+  if (optind >= argc)
+  {
+    show_usage(stderr);
+    return EXIT_FAILURE;
+  }
+
+  for (k = optind; k < argc; k++)
+  {
+    name = base_name(argv[k]);
+    wall = cpu = HUGE_VAL;
+    maxrss = 0;
+    memset(&stats, 0, sizeof stats);
+    cells = NULL;
+    status = ST_CRASH;
+    for (run = 0; run < gruns; run++)
+    {
+      free(cells);
+      status = run_once(argv[k], &report, &cells);
+      if (cells == NULL)
+      {
+        wall = cpu = 0;
+        break;
+      }
+      stats = report.stats;
+      if (report.wall < wall)
+        wall = report.wall;
+      if (report.cpu < cpu)
+        cpu = report.cpu;
+      if (report.maxrss > maxrss)
+        maxrss = report.maxrss;
+    }
+    if (status == ST_UNCHECKED)
+    {
+      if (gnewgolden != NULL)
+        write_golden(name, cells, report.width, report.height);
+      golden = ggolden != NULL ? find_golden(name, report.width, report.height) : NULL;
+      if (golden != NULL && memcmp(golden, cells, (size_t) report.width * report.height) == 0)
+        status = ST_OK;
+      else if (!check_solution(argv[k], cells))
+        status = ST_WRONG;
+      else if (golden != NULL)
+        status = ST_ALT;
+      free(golden);
+    }
+    free(cells);
+    if (status == ST_ALT || status == ST_UNCHECKED)
+      fprintf(stderr, "%s: %s\n", name, status_names[status]);
+    else if (status != ST_OK)
+    {
+      fprintf(stderr, "%s: %s\n", name, status_names[status]);
+      nfailures++;
+    }
+    print_result(output, k == optind, name, status, wall, cpu, &stats, maxrss);
+    totalwall += wall;
+    totalcpu += cpu;
+
+    base = find_baseline(name);
+    if (base != NULL && status <= ST_UNCHECKED) // i.e. solved
+    {
+      basewall += base->wall;
+      basecpu += base->cpu;
+      comparedwall += wall;
+      comparedcpu += cpu;
+      nregressions += regressed(name, "wall time", base->wall, wall, gnoise);
+      nregressions += regressed(name, "CPU time", base->cpu, cpu, gnoise);
+      nregressions += regressed(name, "fingercounter", base->fingercounter, stats.fingercounter, 0);
+      nregressions += regressed(name, "nodes", base->nodes, stats.nodes, 0);
+      nregressions += regressed(name, "peak RSS", base->maxrss, maxrss, 512);
+    }
+  }
+  if (gbaseline != NULL)
+  {
+    nregressions += regressed("total", "wall time", basewall, comparedwall, gnoise);
+    nregressions += regressed("total", "CPU time", basecpu, comparedcpu, gnoise);
+  }
+  if (gjson)
+    fprintf(output, "\n]\n");
+  if (output != stdout)
+    fclose(output);
+  if (gnewgolden != NULL)
+    fclose(gnewgolden);
+
+  fprintf(stderr, "%d puzzles: wall time %.3f s, CPU time %.3f s", argc - optind, totalwall, totalcpu);
+  if (gbaseline != NULL)
+    fprintf(stderr, " (compared with the baseline: %.3f s -> %.3f s, %.3f s -> %.3f s)",
+      basewall, comparedwall, basecpu, comparedcpu);
+  fprintf(stderr, "; %u failures", nfailures);
+  if (gbaseline != NULL)
+    fprintf(stderr, ", %u regressions", nregressions);
+  fprintf(stderr, "\n");
+  return nfailures > 0 || nregressions > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/* vim:set ts=2 sts=2 sw=2 et: */
@@ -0,0 +1,215 @@
+/* Copyright © 2026 Jakub Wilk <jwilk@jwilk.net>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* A client for server mode, for trying the server out and for testing it.
+ *
+ * The requests are sent over one connection, in order, and each response is
+ * written to stdout as it comes. A request is a file name, whose contents
+ * are sent; "-", for an empty request (asking for the counters); or "=N",
+ * for just a header that announces N bytes, with nothing after it.
+ *
+ * If the server closes the connection early, "(closed)" is written instead,
+ * and the exit status is 1.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "autoconf.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNIX_SOCKETS
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+#include <unistd.h>
+
+#ifdef HAVE_UNIX_SOCKETS
+
+static bool read_fully(int fd, char *data, size_t size)
+{
+  ssize_t n;
+
+  while (size > 0)
+  {
+    n = read(fd, data, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+static bool write_fully(int fd, const char *data, size_t size)
+{
+  ssize_t n;
+
+  while (size > 0)
+  {
+    n = write(fd, data, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+static bool write_header(int fd, uint32_t size)
+{
+  unsigned char header[4] = { size >> 24, size >> 16, size >> 8, size };
+  return write_fully(fd, (const char*) header, sizeof header);
+}
+
+static char *read_file(const char *path, size_t *size)
+// Return NULL (setting errno) if the file can't be read.
+{
+  FILE *file = fopen(path, "rb");
+  char *data = NULL;
+  size_t capacity = 0, n;
+
+  if (file == NULL)
+    return NULL;
+  *size = 0;
+  do
+  {
+    if (*size == capacity)
+    {
+      capacity = capacity > 0 ? 2 * capacity : 4096;
+      data = realloc(data, capacity);
+      if (data == NULL)
+      {
+        perror("bench/client");
+        exit(EXIT_FAILURE);
+      }
+    }
+    n = fread(data + *size, 1, capacity - *size, file);
+    *size += n;
+  }
+  while (n > 0);
+  if (ferror(file))
+  {
+    free(data);
+    data = NULL;
+  }
+  fclose(file);
+  return data;
+}
+
+static bool send_request(int fd, const char *request)
+{
+  char *data;
+  size_t size;
+  bool ok;
+
+  if (strcmp(request, "-") == 0)
+    return write_header(fd, 0);
+  if (request[0] == '=')
+    return write_header(fd, strtoul(request + 1, NULL, 10));
+  data = read_file(request, &size);
+  if (data == NULL)
+  {
+    perror(request);
+    exit(EXIT_FAILURE);
+  }
+  ok = write_header(fd, size) && write_fully(fd, data, size);
+  free(data);
+  return ok;
+}
+
+static bool show_response(int fd)
+{
+  unsigned char header[4];
+  uint32_t size;
+  char *data;
+  bool ok;
+
+  if (!read_fully(fd, (char*) header, sizeof header))
+    return false;
+  size = (uint32_t) header[0] << 24 | (uint32_t) header[1] << 16 | (uint32_t) header[2] << 8 | header[3];
+  data = malloc(size > 0 ? size : 1);
+  if (data == NULL)
+  {
+    perror("bench/client");
+    exit(EXIT_FAILURE);
+  }
+  ok = read_fully(fd, data, size);
+  if (ok)
+    fwrite(data, 1, size, stdout);
+  free(data);
+  return ok;
+}
+
+int main(int argc, char **argv)
+{
+  struct sockaddr_un addr;
+  int fd, k;
+
+  if (argc < 2 || strlen(argv[1]) >= sizeof addr.sun_path)
+  {
+    fprintf(stderr, "Usage: %s SOCKET [FILE | - | =N]...\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  signal(SIGPIPE, SIG_IGN); // a server that hangs up early is what some tests are after
+  memset(&addr, 0, sizeof addr);
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, argv[1]);
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0 || connect(fd, (const struct sockaddr*) &addr, sizeof addr) < 0)
+  {
+    perror(argv[1]);
+    return EXIT_FAILURE;
+  }
+  for (k = 2; k < argc; k++)
+  {
+    if (!send_request(fd, argv[k]) || !show_response(fd))
+    {
+      printf("(closed)\n");
+      return EXIT_FAILURE;
+    }
+    fflush(stdout);
+  }
+  close(fd);
+  return EXIT_SUCCESS;
+}
+
+#else
+
+int main(int argc, char **argv)
+{
+  (void)argc;
+  fprintf(stderr, "%s: Unix domain sockets are not supported on this system\n", argv[0]);
+  return EXIT_FAILURE;
+}
+
+#endif
+
+/* vim:set ts=2 sts=2 sw=2 et: */
@@ -0,0 +1,323 @@
+/* Copyright © 2026 Jakub Wilk <jwilk@jwilk.net>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* The queue microbenchmark.
+ *
+ * The bucket queue from queue.c is run against the binary heap that it
+ * replaced, on the same synthetic workload: every round enqueues all the
+ * lines, as shake() does, and then keeps popping lines, each of which
+ * re-enqueues a few others with random, mostly lower, factors.
+ *
+ * With --check, it checks the order in which the bucket queue serves ids
+ * against a brute-force search for the lowest factor instead, on the same
+ * kind of workload.
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "autoconf.h"
+
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memory.h"
+#include "nonogram.h"
+#include "queue.h"
+#include "timer.h"
+
+#define ROUNDS_OPS 4000000 // queue operations per measurement
+
+/* The binary heap, as it was before the bucket queue. */
+
+typedef struct
+{
+  unsigned int id;
+  int factor;
+} HeapItem;
+
+typedef struct
+{
+  unsigned int capacity;
+  unsigned int size;
+  unsigned int *enqueued;
+  HeapItem *elements;
+} Heap;
+
+static inline void update_heap_enq(Heap *heap, unsigned int i)
+{
+  heap->enqueued[heap->elements[i].id] = i;
+}
+
+static void heapify_heap(Heap *heap)
+{
+  unsigned int i, l, r, max;
+  HeapItem ivalue;
+
+  i = 0;
+  while (true)
+  {
+    ivalue = heap->elements[i];
+    l = 2 * i + 1;
+    r = l + 1;
+    max = (l < heap->size && heap->elements[l].factor > ivalue.factor) ? l : i;
+    if (r < heap->size && heap->elements[r].factor > heap->elements[max].factor)
+      max = r;
+    if (max != i)
+    {
+      heap->elements[i] = heap->elements[max];
+      heap->elements[max] = ivalue;
+      update_heap_enq(heap, i);
+      update_heap_enq(heap, max);
+      i = max;
+    }
+    else
+      return;
+  }
+}
+
+static Heap *alloc_heap(unsigned int capacity)
+{
+  Heap *tmp = alloc(sizeof (Heap));
+  tmp->capacity = capacity;
+  tmp->enqueued = alloc(capacity * sizeof (unsigned int));
+  memset(tmp->enqueued, -1, capacity * sizeof (unsigned int));
+  tmp->elements = alloc(capacity * sizeof (HeapItem));
+  return tmp;
+}
+
+static void free_heap(Heap *heap)
+{
+  free(heap->enqueued);
+  free(heap->elements);
+  free(heap);
+}
+
+static void clear_heap(Heap *heap)
+{
+  unsigned int i;
+  for (i = 0; i < heap->size; i++)
+    heap->enqueued[heap->elements[i].id] = -1U;
+  heap->size = 0;
+}
+
+static bool put_into_heap(Heap *heap, unsigned int id, int factor)
+{
+  unsigned int i, j;
+
+  factor = -factor;
+  i = heap->enqueued[id];
+  if (i == -1U)
+    i = heap->size++;
+  else if (factor <= heap->elements[i].factor)
+    return false;
+
+  while (i > 0 && heap->elements[j = (i-1)/2].factor < factor)
+  {
+    heap->elements[i] = heap->elements[j];
+    update_heap_enq(heap, i);
+    i = j;
+  }
+
+  heap->elements[i].id = id;
+  heap->elements[i].factor = factor;
+  update_heap_enq(heap, i);
+  return true;
+}
+
+static unsigned int get_from_heap(Heap *heap)
+{
+  unsigned int resultid, last;
+  resultid = heap->elements[0].id;
+  last = --heap->size;
+  if (heap->size > 0)
+  {
+    heap->elements[0] = heap->elements[last];
+    update_heap_enq(heap, 0);
+    heapify_heap(heap);
+  }
+  heap->enqueued[resultid] = -1U;
+  return resultid;
+}
+
+/* The workload. */
+
+static uint32_t grandom;
+
+static inline uint32_t next_random(void)
+// xorshift32, so that both queues see the same operations.
+{
+  grandom ^= grandom << 13;
+  grandom ^= grandom >> 17;
+  grandom ^= grandom << 5;
+  return grandom;
+}
+
+static inline int random_factor(void)
+{
+  return next_random() % (MAX_QUEUE_FACTOR + 1);
+}
+
+#define WORKLOAD(queue, put, get, clear, empty) \
+  do { \
+    unsigned int i, k; \
+    uint64_t ops = 0; \
+    grandom = 2463534242U; \
+    while (ops < ROUNDS_OPS) \
+    { \
+      for (i = 0; i < nlines; i++, ops++) \
+        put(queue, i, random_factor()); \
+      for (k = 0; !empty(queue); k++, ops++) \
+      { \
+        get(queue); \
+        if (k < 4 * nlines) \
+          for (i = next_random() % 8; i > 0; i--, ops++) \
+            put(queue, next_random() % nlines, random_factor()); \
+      } \
+      clear(queue); \
+    } \
+    nops = ops; \
+  } while (0)
+
+static inline bool is_heap_empty(Heap *heap)
+{
+  return heap->size == 0;
+}
+
+static double run_heap(unsigned int nlines, uint64_t *rnops)
+{
+  Heap *heap = alloc_heap(nlines);
+  uint64_t nops;
+  double t = get_time();
+  WORKLOAD(heap, put_into_heap, get_from_heap, clear_heap, is_heap_empty);
+  t = get_time() - t;
+  free_heap(heap);
+  *rnops = nops;
+  return t;
+}
+
+static double run_queue(unsigned int nlines, uint64_t *rnops)
+{
+  Queue *queue = alloc_queue(nlines);
+  uint64_t nops;
+  double t = get_time();
+  WORKLOAD(queue, put_into_queue, get_from_queue, clear_queue, is_queue_empty);
+  t = get_time() - t;
+  free_queue(queue);
+  *rnops = nops;
+  return t;
+}
+
+static bool check_queue(unsigned int nlines)
+// Check that ids are served in order of the lowest factor they were enqueued
+// with, and that every id is served once however often it was enqueued, as
+// long as it was waiting.
+{
+  Queue *queue = alloc_queue(nlines);
+  int *factor = alloc(nlines * sizeof (int)); // the lowest factor of each waiting id, or -1
+  unsigned int i, k, id, waiting = 0;
+  int f, min;
+  bool ok = true;
+
+  grandom = 2463534242U;
+  memset(factor, -1, nlines * sizeof (int));
+  for (k = 0; k < 50 * nlines && ok; k++)
+  {
+    if (waiting == 0 || next_random() % 3 != 0)
+    {
+      id = next_random() % nlines;
+      f = random_factor();
+      if (factor[id] < 0)
+        waiting++;
+      if (factor[id] < 0 || f < factor[id])
+        factor[id] = f;
+      put_into_queue(queue, id, f);
+      continue;
+    }
+    id = get_from_queue(queue);
+    min = INT_MAX;
+    for (i = 0; i < nlines; i++)
+      if (factor[i] >= 0 && factor[i] < min)
+        min = factor[i];
+    if (factor[id] != min)
+    {
+      fprintf(stderr, "%u lines: served %u (factor %d), but the lowest factor is %d\n", nlines, id, factor[id], min);
+      ok = false;
+    }
+    factor[id] = -1;
+    waiting--;
+  }
+  while (ok && waiting > 0)
+  {
+    id = get_from_queue(queue);
+    ok = factor[id] >= 0;
+    factor[id] = -1;
+    waiting--;
+  }
+  if (ok && !is_queue_empty(queue))
+  {
+    fprintf(stderr, "%u lines: ids left over in the queue\n", nlines);
+    ok = false;
+  }
+  free(factor);
+  free_queue(queue);
+  return ok;
+}
+
+int main(int argc, char **argv)
+{
+  static const unsigned int default_sizes[] = { 50, 200, 1000, 2000 };
+  unsigned int i, nsizes, nlines;
+  uint64_t nops;
+  double t;
+  const char *prog = argv[0];
+  bool check = argc > 1 && strcmp(argv[1], "--check") == 0;
+
+  if (check)
+    argc--, argv++;
+  nsizes = argc > 1 ? argc - 1 : sizeof default_sizes / sizeof default_sizes[0];
+  for (i = 0; i < nsizes; i++)
+  {
+    nlines = argc > 1 ? strtoul(argv[i + 1], NULL, 10) : default_sizes[i];
+    if (nlines == 0)
+    {
+      fprintf(stderr, "Usage: %s [--check] [lines...]\n", prog);
+      return EXIT_FAILURE;
+    }
+    if (check)
+    {
+      if (!check_queue(nlines))
+        return EXIT_FAILURE;
+      printf("%5u lines: ok\n", nlines);
+      continue;
+    }
+    t = run_heap(nlines, &nops);
+    printf("%5u lines: heap   %6.1f ns/op\n", nlines, t * 1e9 / nops);
+    t = run_queue(nlines, &nops);
+    printf("%5u lines: bucket %6.1f ns/op\n", nlines, t * 1e9 / nops);
+  }
+  return EXIT_SUCCESS;
+}
+
+/* vim:set ts=2 sts=2 sw=2 et: */
@@ -0,0 +1,147 @@
+/* Copyright © 2026 Jakub Wilk <jwilk@jwilk.net>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Direct-mapped cache of line solver results.
+//
+// Each slot consists of a header word followed by four spans of nwords
+// words: the known filled and empty cells (the key), and the cells that
+// are always filled and always empty (the value). The header holds the
+// line number plus one (0 for empty slots), and bit 32 is set if the line
+// had no placement at all.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+#include "line.h"
+#include "memory.h"
+
+#define NO_PLACEMENT (UINT64_C(1) << 32)
+#define EPOCH_SHIFT 33
+#define MAX_EPOCH (UINT64_C(1) << (64 - EPOCH_SHIFT))
+
+static inline size_t slot_words(LineCache *cache)
+{
+  return 1 + 4 * (size_t)cache->nwords;
+}
+
+static inline uint64_t slot_key(LineCache *cache, unsigned int line)
+{
+  return (cache->epoch << EPOCH_SHIFT) | (line + 1);
+}
+
+static size_t hash_line(unsigned int line, const uint64_t *filled, const uint64_t *empty, unsigned int nw)
+{
+  unsigned int i;
+  uint64_t h = line + UINT64_C(0x9E3779B97F4A7C15);
+  for (i = 0; i < nw; i++)
+  {
+    h = (h ^ filled[i]) * UINT64_C(0xFF51AFD7ED558CCD);
+    h = (h ^ empty[i]) * UINT64_C(0xC4CEB9FE1A85EC53);
+    h ^= h >> 29;
+  }
+  h ^= h >> 32;
+  return (size_t)h;
+}
+
+LineCache *alloc_line_cache(unsigned int maxsize, size_t budget)
+// Allocate a cache for lines up to maxsize cells, using at most budget bytes.
+// Return NULL if the budget is too small for even a single slot.
+{
+  LineCache *tmp;
+  unsigned int nw = span_words(maxsize);
+  size_t nslots, size = (1 + 4 * (size_t)nw) * sizeof (uint64_t);
+
+  if (budget < size)
+    return NULL;
+  for (nslots = 1; nslots * 2 * size <= budget; nslots *= 2)
+    ;
+  tmp = alloc(sizeof (LineCache));
+  tmp->nwords = nw;
+  tmp->nslots = nslots;
+  tmp->slots = alloc(nslots * size);
+  tmp->epoch = 0;
+  tmp->hits = tmp->misses = 0;
+  return tmp;
+}
+
+void free_line_cache(LineCache *cache)
+{
+  free(cache->slots);
+  free(cache);
+}
+
+void clear_line_cache(LineCache *cache)
+// Forget everything, so that the cache can be used for another puzzle.
+// Slots are invalidated lazily, by tagging new ones with a new epoch.
+{
+  cache->epoch++;
+  if (cache->epoch == MAX_EPOCH)
+  {
+    memset(cache->slots, 0, cache->nslots * slot_words(cache) * sizeof (uint64_t));
+    cache->epoch = 0;
+  }
+  cache->hits = cache->misses = 0;
+}
+
+int lookup_line_cache(LineCache *cache, unsigned int line, const uint64_t *filled, const uint64_t *empty, unsigned int nw,
+  uint64_t *rfilled, uint64_t *rempty)
+// Look up the result of solve_line() for the line with the given known cells.
+// Return -1 if it's not in the cache.
+// Otherwise, copy the result to rfilled and rempty,
+// and return what solve_line() returned.
+{
+  uint64_t *slot = cache->slots + (hash_line(line, filled, empty, nw) & (cache->nslots - 1)) * slot_words(cache);
+  size_t span = nw * sizeof (uint64_t);
+
+  if ((slot[0] & ~NO_PLACEMENT) == slot_key(cache, line) &&
+    memcmp(slot + 1, filled, span) == 0 &&
+    memcmp(slot + 1 + cache->nwords, empty, span) == 0)
+  {
+    cache->hits++;
+    if (slot[0] & NO_PLACEMENT)
+      return false;
+    memcpy(rfilled, slot + 1 + 2 * cache->nwords, span);
+    memcpy(rempty, slot + 1 + 3 * cache->nwords, span);
+    return true;
+  }
+  cache->misses++;
+  return -1;
+}
+
+void store_line_cache(LineCache *cache, unsigned int line, const uint64_t *filled, const uint64_t *empty, unsigned int nw,
+  const uint64_t *rfilled, const uint64_t *rempty, bool ok)
+// Remember the result of solve_line(), possibly evicting another one.
+{
+  uint64_t *slot = cache->slots + (hash_line(line, filled, empty, nw) & (cache->nslots - 1)) * slot_words(cache);
+  size_t span = nw * sizeof (uint64_t);
+
+  slot[0] = slot_key(cache, line) | (ok ? 0 : NO_PLACEMENT);
+  memcpy(slot + 1, filled, span);
+  memcpy(slot + 1 + cache->nwords, empty, span);
+  if (ok)
+  {
+    memcpy(slot + 1 + 2 * cache->nwords, rfilled, span);
+    memcpy(slot + 1 + 3 * cache->nwords, rempty, span);
+  }
+}
+
+/* vim:set ts=2 sts=2 sw=2 et: */
@@ -0,0 +1,46 @@
+/* Copyright © 2026 Jakub Wilk <jwilk@jwilk.net>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef NONOGRAM_CACHE_H
+#define NONOGRAM_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct
+{
+  unsigned int nwords; // words per line
+  size_t nslots;       // always a power of 2
+  uint64_t *slots;
+  uint64_t epoch; // bumped whenever the cache is cleared
+  uint64_t hits, misses;
+} LineCache;
+
+LineCache *alloc_line_cache(unsigned int, size_t);
+void free_line_cache(LineCache*);
+void clear_line_cache(LineCache*);
+int lookup_line_cache(LineCache*, unsigned int, const uint64_t*, const uint64_t*, unsigned int, uint64_t*, uint64_t*);
+void store_line_cache(LineCache*, unsigned int, const uint64_t*, const uint64_t*, unsigned int, const uint64_t*, const uint64_t*, bool);
+
+#endif
+
+/* vim:set ts=2 sts=2 sw=2 et: */
@@ -22,29 +22,61 @@
 #include "autoconf.h"
 
 #include <getopt.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdbool.h>
 #include <stdlib.h>
 
 #include "config.h"
+#include "nonogram.h"
 
 Config config = {
   .color = false,
   .utf8 = false,
   .html = false,
   .xhtml = false,
-  .stats = false
+  .stats = false,
+  .unique = false,
+  .threads = 1,
+  .batch = false,
+  .jobs = 1,
+  .time_limit = 0,
+  .node_limit = 0,
+  .memory_limit = 0,
+  .progress = 0,
+  .serve = NULL,
+  .cache_dir = NULL
 };
 
 static void show_usage(void)
 {
   printf(
-    "Usage: nonogram [OPTIONS]\n\n"
+    "Usage: nonogram [OPTIONS]\n"
+    "       nonogram --batch [OPTIONS] [FILE|DIRECTORY|@LIST ...]\n"
+    "       nonogram --serve=SOCKET [OPTIONS]\n\n"
     "Options:\n"
     "  -c, --colors     use colors\n"
     "  -u, --utf-8      use UTF-8 drawing characters\n"
     "  -H, --html       HTML output\n"
     "  -X, --xhtml      XHTML output\n"
+    "  -t, --threads=N  use N threads for backtracking\n"
+    "  -b, --batch      solve all puzzles from the given files\n"
+    "  -j, --jobs=N     in batch mode, solve N puzzles at a time;\n"
+    "                   when serving, serve N connections at a time\n"
+    "      --serve=SOCKET\n"
+    "                   serve puzzles on the Unix domain socket\n"
+    "  -s, --statistics print solver statistics to stderr\n"
+    "      --unique     check that the solution is unique\n"
+    "      --time-limit=SECONDS\n"
+    "                   give up on a puzzle after SECONDS seconds\n"
+    "      --node-limit=N\n"
+    "                   give up on a puzzle after N guesses\n"
+    "      --memory-limit=MIB\n"
+    "                   give up when more than MIB mebibytes of memory are in use\n"
+    "      --progress[=SECONDS]\n"
+    "                   report progress to stderr every SECONDS seconds\n"
+    "      --cache-dir=DIR\n"
+    "                   keep solutions in DIR, and reuse them\n"
 #if ENABLE_DEBUG
     "  -f, --file=FILE  validate the result using FILE\n"
 #endif
@@ -59,7 +91,49 @@ static void show_version(void)
   exit(EXIT_SUCCESS);
 }
 
-void parse_arguments(int argc, char **argv, char **vfn)
+static unsigned int parse_count(const char *prog, const char *what, const char *arg)
+{
+  unsigned long n;
+  char *end;
+
+  n = strtoul(arg, &end, 10);
+  if (*arg < '0' || *arg > '9' || *end != '\0' || n < 1 || n > MAX_THREADS)
+  {
+    fprintf(stderr, "%s: invalid number of %s: %s\n", prog, what, arg);
+    exit(EXIT_FAILURE);
+  }
+  return n;
+}
+
+static double parse_seconds(const char *prog, const char *what, const char *arg)
+{
+  double t;
+  char *end;
+
+  t = strtod(arg, &end);
+  if (*arg < '0' || *arg > '9' || *end != '\0' || !(t > 0) || t > 1e9)
+  {
+    fprintf(stderr, "%s: invalid %s: %s\n", prog, what, arg);
+    exit(EXIT_FAILURE);
+  }
+  return t;
+}
+
+static uint64_t parse_limit(const char *prog, const char *what, const char *arg, uint64_t max)
+{
+  unsigned long long n;
+  char *end;
+
+  n = strtoull(arg, &end, 10);
+  if (*arg < '0' || *arg > '9' || *end != '\0' || n < 1 || n > max)
+  {
+    fprintf(stderr, "%s: invalid %s limit: %s\n", prog, what, arg);
+    exit(EXIT_FAILURE);
+  }
+  return n;
+}
+
+void parse_arguments(int argc, char **argv, char **vfn, char ***paths, unsigned int *npaths)
 {
   static struct option options [] =
   {
@@ -70,8 +144,18 @@ void parse_arguments(int argc, char **argv, char **vfn)
     { "utf-8",      0, 0, 'u' },
     { "html",       0, 0, 'H' },
     { "xhtml",      0, 0, 'X' },
+    { "threads",    1, 0, 't' },
+    { "batch",      0, 0, 'b' },
+    { "jobs",       1, 0, 'j' },
     { "file",       0, 0, 'f' }, // XXX undocumented
-    { "statistics", 0, 0, 's' }, // XXX undocumented
+    { "statistics", 0, 0, 's' },
+    { "unique",     0, 0, 'U' },
+    { "time-limit", 1, 0, 'T' },
+    { "node-limit", 1, 0, 'N' },
+    { "memory-limit", 1, 0, 'M' },
+    { "progress",   2, 0, 'P' },
+    { "serve",      1, 0, 'S' },
+    { "cache-dir",  1, 0, 'D' },
     { NULL,         0, 0, '\0' }
   };
 
@@ -80,7 +164,7 @@ void parse_arguments(int argc, char **argv, char **vfn)
   while (true)
   {
     optindex = 0;
-    c = getopt_long(argc, argv, "vhcmuHXsf:", options, &optindex);
+    c = getopt_long(argc, argv, "vhcmuHXst:bj:f:", options, &optindex);
     if (c < 0)
       break;
     if (c == 0)
@@ -115,12 +199,44 @@ void parse_arguments(int argc, char **argv, char **vfn)
     case 's':
       config.stats = true;
       break;
+    case 'U':
+      config.unique = true;
+      break;
+    case 'T':
+      config.time_limit = parse_seconds(argv[0], "time limit", optarg);
+      break;
+    case 'N':
+      config.node_limit = parse_limit(argv[0], "node", optarg, UINT64_MAX);
+      break;
+    case 'S':
+      config.serve = optarg;
+      break;
+    case 'D':
+      config.cache_dir = optarg;
+      break;
+    case 'P':
+      config.progress = optarg != NULL ? parse_seconds(argv[0], "progress interval", optarg) : 1;
+      break;
+    case 'M':
+      config.memory_limit = parse_limit(argv[0], "memory", optarg, SIZE_MAX >> 20) << 20;
+      break;
+    case 't':
+      config.threads = parse_count(argv[0], "threads", optarg);
+      break;
+    case 'b':
+      config.batch = true;
+      break;
+    case 'j':
+      config.jobs = parse_count(argv[0], "jobs", optarg);
+      break;
     default:
       exit(EXIT_FAILURE);
       ;
     }
   }
-  if (optind < argc)
+  *paths = argv + optind;
+  *npaths = argc - optind;
+  if (optind < argc && (!config.batch || config.serve != NULL))
   {
     fprintf(stderr, "%s: too many arguments\n", argv[0]);
     exit(EXIT_FAILURE);
@@ -23,6 +23,8 @@
 #define NONOGRAM_CONFIG_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 typedef struct
 {
@@ -31,11 +33,21 @@ typedef struct
   bool html;   // print HTML instead of plain text
   bool xhtml;  // print XHTML instead of plain text
   bool stats;
+  bool unique; // check that the solution is unique
+  unsigned int threads; // number of threads used for backtracking
+  bool batch;           // solve all puzzles from the files given on the command line
+  unsigned int jobs;    // number of puzzles solved at the same time in batch mode
+  double time_limit;     // seconds to spend on a puzzle, or 0
+  uint64_t node_limit;   // guesses to make on a puzzle, or 0
+  size_t memory_limit;   // bytes of memory to use, or 0
+  double progress;       // seconds between progress reports, or 0
+  const char *serve;     // the socket to serve puzzles on, or NULL
+  const char *cache_dir; // the directory to keep solutions in, or NULL
 } Config;
 
 extern Config config;
 
-void parse_arguments(int, char**, char**);
+void parse_arguments(int, char**, char**, char***, unsigned int*);
 
 #endif
 
@@ -19,9 +19,103 @@
  * SOFTWARE.
  */
 
+#include "autoconf.h"
+
+#include <errno.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
 
 #include "io.h"
+#include "memory.h"
+
+#define READ_BLOCK_SIZE (1 << 16)
+
+Reader *alloc_reader(int fd)
+// Prepare to read from fd, starting at its current offset.
+// Regular files are mapped into memory if possible;
+// anything else is read in large blocks.
+// The file descriptor is not closed by free_reader().
+{
+  Reader *tmp = alloc(sizeof(Reader));
+  off_t offset;
+#ifdef HAVE_MMAP
+  struct stat st;
+  void *map;
+#endif
+
+  tmp->line = 1;
+  tmp->fd = fd;
+  offset = lseek(fd, 0, SEEK_CUR);
+  tmp->seekable = offset >= 0;
+#ifdef HAVE_MMAP
+  if (tmp->seekable && fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > offset && (off_t)(size_t) st.st_size == st.st_size)
+  {
+    map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map != MAP_FAILED && lseek(fd, st.st_size, SEEK_SET) >= 0)
+    {
+      tmp->map = map;
+      tmp->mapsize = st.st_size;
+      tmp->pos = (char*) map + offset;
+      tmp->end = (char*) map + st.st_size;
+      return tmp;
+    }
+    if (map != MAP_FAILED)
+      munmap(map, st.st_size);
+  }
+#endif
+  tmp->buffer = alloc(READ_BLOCK_SIZE);
+  tmp->pos = tmp->end = tmp->buffer;
+  return tmp;
+}
+
+Reader *alloc_buffer_reader(const char *buffer, size_t size)
+// Prepare to read from the buffer, which must be kept around meanwhile.
+{
+  Reader *tmp = alloc(sizeof(Reader));
+  tmp->line = 1;
+  tmp->fd = -1;
+  tmp->pos = buffer;
+  tmp->end = buffer + size;
+  return tmp;
+}
+
+void free_reader(Reader *reader)
+// If the file is seekable, what was read ahead is given back,
+// so that the file offset ends up right after what was consumed.
+{
+  if (reader->seekable && reader->pos < reader->end)
+    lseek(reader->fd, -(off_t)(reader->end - reader->pos), SEEK_CUR);
+#ifdef HAVE_MMAP
+  if (reader->map != NULL)
+    munmap(reader->map, reader->mapsize);
+#endif
+  free(reader->buffer);
+  free(reader);
+}
+
+bool fill_reader(Reader *reader)
+// Read the next block.
+// Return false at the end of the file, or if an error occurred.
+{
+  ssize_t n;
+
+  if (reader->buffer == NULL)
+    return false; // everything is in memory already
+  do
+    n = read(reader->fd, reader->buffer, READ_BLOCK_SIZE);
+  while (n < 0 && errno == EINTR);
+  if (n <= 0)
+    return false;
+  reader->pos = reader->buffer;
+  reader->end = reader->buffer + n;
+  return true;
+}
 
 char freadchar(FILE *file)
 // Try reading one char from the file.
@@ -32,12 +126,4 @@ char freadchar(FILE *file)
   return c == EOF ? '\0': c;
 }
 
-char readchar(void)
-// Try reading one char from stdin.
-// If there's nothing to read or an error occurred, return '\0'.
-// Otherwise, return the char.
-{
-  return freadchar(stdin);
-}
-
 /* vim:set ts=2 sts=2 sw=2 et: */
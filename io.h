@@ -22,10 +22,39 @@
 #ifndef NONOGRAM_IO_H
 #define NONOGRAM_IO_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdio.h>
 
+typedef struct nonogram_reader
+{
+  const char *pos, *end; // what's left of the buffered input
+  unsigned int line;     // the number of the line pos is at
+  int fd;                // -1 for in-memory buffers
+  bool seekable;
+  char *buffer;          // for reading fd in blocks; NULL if everything is in memory
+  void *map;             // the file, if it's mapped into memory
+  size_t mapsize;
+} Reader;
+
+Reader *alloc_reader(int);
+Reader *alloc_buffer_reader(const char*, size_t);
+void free_reader(Reader*);
+bool fill_reader(Reader*);
+
+static inline char next_char(Reader *reader)
+// Return the next char, or '\0' at the end of the input.
+{
+  char c;
+  if (reader->pos == reader->end && !fill_reader(reader))
+    return '\0';
+  c = *reader->pos++;
+  if (c == '\n')
+    reader->line++;
+  return c;
+}
+
 char freadchar(FILE *file);
-char readchar(void);
 
 #endif
 
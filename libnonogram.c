@@ -0,0 +1,255 @@
+/* Copyright © 2026 Jakub Wilk <jwilk@jwilk.net>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "autoconf.h"
+
+#include <stdio.h>
+
+#include "io.h"
+#include "libnonogram.h"
+#include "nonogram.h"
+#include "puzzle.h"
+#include "solver.h"
+#include "store.h"
+
+nonogram_reader *nonogram_open_fd(int fd)
+// Prepare to read puzzles from the file descriptor.
+// Regular files are mapped into memory; anything else is read in blocks.
+// When the reader is closed, the file offset is moved back to right after
+// the last puzzle read, if possible. The file descriptor is not closed.
+{
+  return alloc_reader(fd);
+}
+
+nonogram_reader *nonogram_open_buffer(const char *buffer, size_t size)
+// Prepare to read puzzles from the buffer.
+// The buffer must be kept around until the reader is closed.
+{
+  return alloc_buffer_reader(buffer, size);
+}
+
+void nonogram_close_reader(nonogram_reader *reader)
+{
+  free_reader(reader);
+}
+
+unsigned int nonogram_reader_line(const nonogram_reader *reader)
+// Return the number of the line the reader is at.
+{
+  return reader->line;
+}
+
+nonogram_puzzle *nonogram_read_puzzle(nonogram_reader *reader, unsigned int *where)
+// Read the next puzzle.
+// *where is set to the line the puzzle starts at,
+// or, if the input is invalid, to the offending line.
+// Return NULL at the end of the input (setting *where to 0),
+// or if the input is invalid.
+{
+  return read_puzzle(reader, where);
+}
+
+void nonogram_free_puzzle(nonogram_puzzle *puzzle)
+{
+  free_puzzle(puzzle);
+}
+
+unsigned int nonogram_puzzle_width(const nonogram_puzzle *puzzle)
+{
+  return puzzle->xsize;
+}
+
+unsigned int nonogram_puzzle_height(const nonogram_puzzle *puzzle)
+{
+  return puzzle->ysize;
+}
+
+nonogram_solver *nonogram_solver_create(unsigned int nthreads)
+// Create a solver that backtracks in nthreads threads.
+{
+  if (nthreads < 1)
+    nthreads = 1;
+  if (nthreads > MAX_THREADS)
+    nthreads = MAX_THREADS;
+  return alloc_solver(nthreads);
+}
+
+void nonogram_solver_destroy(nonogram_solver *solver)
+{
+  free_solver(solver);
+}
+
+void nonogram_set_unique(nonogram_solver *solver, bool unique)
+// Make nonogram_backtrack() look for a second solution,
+// and return NONOGRAM_MULTIPLE if there is one.
+// NONOGRAM_SOLVED then means that the solution is unique.
+{
+  solver->maxsolutions = unique ? 2 : 1;
+}
+
+void nonogram_set_limits(nonogram_solver *solver, double seconds, uint64_t nodes, size_t memory)
+// Make the solver give up, and return NONOGRAM_STOPPED, once it has spent
+// that many seconds on a puzzle, made that many guesses, or once the whole
+// process uses that many bytes of memory (resident set size, as of now, not
+// the peak; where /proc/self/statm is missing, there is no memory limit).
+// 0 means no limit.
+{
+  solver->timelimit = seconds;
+  solver->maxnodes = nodes;
+  solver->maxmemory = memory;
+}
+
+void nonogram_set_interrupt(nonogram_solver *solver, const volatile sig_atomic_t *flag)
+// Make the solver give up, and return NONOGRAM_STOPPED, as soon as *flag is
+// nonzero. The flag can be set from a signal handler, and shared by solvers.
+{
+  solver->interrupt = flag;
+}
+
+nonogram_store *nonogram_open_store(const char *path)
+// Open the solution store in the directory, creating it if needed.
+// Return NULL (setting errno) if that's not possible.
+{
+  return open_store(path);
+}
+
+void nonogram_close_store(nonogram_store *store)
+{
+  if (store != NULL)
+    free_store(store);
+}
+
+void nonogram_set_store(nonogram_solver *solver, nonogram_store *store)
+// Make the solver look puzzles up in the store (unless it's NULL) before
+// solving them, and remember what it found out there.
+// Mirrored, rotated and transposed puzzles are recognized as the same.
+// A store can be shared by solvers, also in different threads and processes.
+{
+  solver->store = store;
+}
+
+void nonogram_set_progress(nonogram_solver *solver, double interval, const volatile sig_atomic_t *flag,
+  nonogram_progress_callback *callback, void *data)
+// Make the solver report its progress, by calling callback(progress, data),
+// every interval seconds (unless it's 0), and whenever *flag changes
+// (unless flag is NULL). The flag can be bumped from a signal handler,
+// and shared by solvers.
+// The callback is called from whichever thread the solver is running in,
+// and must not use the solver.
+{
+  solver->progressinterval = interval;
+  solver->progressflag = flag;
+  if (flag != NULL)
+    atomic_store(&solver->progressseen, *flag);
+  solver->progresscallback = callback;
+  solver->progressdata = data;
+}
+
+nonogram_result nonogram_solve_lines(nonogram_solver *solver, const nonogram_puzzle *puzzle)
+// Start solving the puzzle, without guessing.
+// The puzzle must be kept around until the solver is done with it.
+{
+  setup_solver(solver, puzzle);
+  switch (recall_solution(solver))
+  {
+  case 0:
+    return NONOGRAM_INCONSISTENT;
+  case 1:
+    return NONOGRAM_SOLVED;
+  }
+  if (!solve_lines(solver))
+  {
+    remember_solution(solver, false, false);
+    return NONOGRAM_INCONSISTENT;
+  }
+  if (solver->picture->counter == 0)
+  {
+    remember_solution(solver, true, true); // line solving leaves no choice
+    return NONOGRAM_SOLVED;
+  }
+  return atomic_load(&solver->stopped) ? NONOGRAM_STOPPED : NONOGRAM_UNSOLVED;
+}
+
+nonogram_result nonogram_backtrack(nonogram_solver *solver)
+// Finish what nonogram_solve_lines() started, by probing and guessing.
+// If the solver gives up, the picture is left with what was known for sure;
+// or, when checking uniqueness, with the first solution, if one was found.
+{
+  bool found;
+  unsigned int n;
+
+  if (solver->picture->counter == 0)
+    return NONOGRAM_SOLVED;
+  found = backtrack(solver);
+  n = atomic_load(&solver->nsolutions);
+  if (n < solver->maxsolutions && atomic_load(&solver->stopped))
+    return NONOGRAM_STOPPED;
+  if (!found)
+  {
+    remember_solution(solver, false, false);
+    return NONOGRAM_INCONSISTENT;
+  }
+  if (n > 1)
+    return NONOGRAM_MULTIPLE;
+  remember_solution(solver, true, solver->maxsolutions > 1);
+  return NONOGRAM_SOLVED;
+}
+
+nonogram_result nonogram_solve(nonogram_solver *solver, const nonogram_puzzle *puzzle)
+{
+  nonogram_result result = nonogram_solve_lines(solver, puzzle);
+  if (result == NONOGRAM_UNSOLVED)
+    result = nonogram_backtrack(solver);
+  return result;
+}
+
+unsigned int nonogram_unknown_cells(const nonogram_solver *solver)
+{
+  return solver->picture->counter;
+}
+
+void nonogram_get_picture(const nonogram_solver *solver, signed char *cells)
+// Copy the cells, row by row, to the buffer:
+// 1 for filled, -1 for empty, and 0 for unknown ones.
+{
+  get_picture(solver, cells);
+}
+
+void nonogram_get_second_picture(const nonogram_solver *solver, signed char *cells)
+// Copy the second solution, in the same format,
+// after nonogram_backtrack() returned NONOGRAM_MULTIPLE.
+{
+  get_second_picture(solver, cells);
+}
+
+void nonogram_get_stats(const nonogram_solver *solver, nonogram_stats *stats)
+{
+  get_stats(solver, stats);
+}
+
+bool nonogram_check_picture(const nonogram_puzzle *puzzle, const signed char *cells)
+// Check that the picture, in the nonogram_get_picture() format,
+// is complete and agrees with the clues.
+{
+  return check_cells(puzzle, cells);
+}
+
+/* vim:set ts=2 sts=2 sw=2 et: */
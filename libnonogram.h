@@ -0,0 +1,125 @@
+/* Copyright © 2026 Jakub Wilk <jwilk@jwilk.net>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef LIBNONOGRAM_H
+#define LIBNONOGRAM_H
+
+/* The solver library.
+ *
+ * A nonogram_solver holds all the state of a solve, and keeps its buffers
+ * between puzzles. Different solvers can be used concurrently from different
+ * threads; a single solver can't. A puzzle is not modified by solving, so it
+ * can be shared between solvers.
+ *
+ * Errors are reported by return values. Running out of memory aborts.
+ */
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__) && !defined(_WIN32)
+#define NONOGRAM_API __attribute__((visibility("default")))
+#else
+#define NONOGRAM_API
+#endif
+
+typedef struct nonogram_reader nonogram_reader;
+typedef struct nonogram_puzzle nonogram_puzzle;
+typedef struct nonogram_solver nonogram_solver;
+typedef struct nonogram_store nonogram_store;
+
+typedef enum
+{
+  NONOGRAM_SOLVED,       // the picture is complete
+  NONOGRAM_UNSOLVED,     // line solving alone was not enough
+  NONOGRAM_INCONSISTENT, // the puzzle has no solution
+  NONOGRAM_MULTIPLE,     // the puzzle has more than one solution (see nonogram_set_unique())
+  NONOGRAM_STOPPED       // the solver gave up early (see nonogram_set_limits() and nonogram_set_interrupt())
+} nonogram_result;
+
+typedef struct
+{
+  uint64_t fingercounter; // number of lines examined
+  uint64_t linesolves;    // number of lines solved, cache hits included
+  uint64_t cells;         // number of cells deduced by solving lines
+  uint64_t pushes, pops;  // line queue operations
+  uint64_t probes;        // number of tentative cell values tried before backtracking
+  uint64_t nodes;         // number of guesses made when backtracking
+  uint64_t failures;      // number of contradictions met when backtracking
+  uint64_t learned;       // number of nogoods learned from them
+  uint64_t backjumps;     // number of times that undid more than one guess
+  unsigned int maxdepth;  // largest number of guesses in effect at once
+  unsigned int components; // number of independent parts searched one by one, or 0 if there was no search
+  bool cache;             // whether the line cache was used
+  bool store;             // whether the solution store was used (see nonogram_set_store())
+  uint64_t storehits, storemisses;
+  bool stopped;           // whether the solver gave up early
+  uint64_t cachehits, cachemisses;
+  double preliminary_shake_time, shake_time, probe_time, backtrack_time; // seconds
+} nonogram_stats;
+
+typedef struct
+{
+  const char *phase;        // "lines", "probing" or "search"
+  double time;              // seconds since the solver started on the puzzle
+  uint64_t fingercounter;   // number of lines examined
+  double lines_per_second;  // since the previous report
+  uint64_t nodes;           // number of guesses made when backtracking
+  double nodes_per_second;  // since the previous report
+  unsigned int depth;       // number of guesses in effect, in the deepest thread
+  unsigned int maxdepth;    // largest number of guesses in effect at once
+  unsigned int unknown;     // number of unknown cells, in the thread that has the fewest
+} nonogram_progress;
+
+typedef void nonogram_progress_callback(const nonogram_progress*, void*);
+
+NONOGRAM_API nonogram_reader *nonogram_open_fd(int);
+NONOGRAM_API nonogram_reader *nonogram_open_buffer(const char*, size_t);
+NONOGRAM_API void nonogram_close_reader(nonogram_reader*);
+NONOGRAM_API unsigned int nonogram_reader_line(const nonogram_reader*);
+NONOGRAM_API nonogram_puzzle *nonogram_read_puzzle(nonogram_reader*, unsigned int*);
+NONOGRAM_API void nonogram_free_puzzle(nonogram_puzzle*);
+NONOGRAM_API unsigned int nonogram_puzzle_width(const nonogram_puzzle*);
+NONOGRAM_API unsigned int nonogram_puzzle_height(const nonogram_puzzle*);
+
+NONOGRAM_API nonogram_solver *nonogram_solver_create(unsigned int);
+NONOGRAM_API void nonogram_solver_destroy(nonogram_solver*);
+NONOGRAM_API void nonogram_set_unique(nonogram_solver*, bool);
+NONOGRAM_API void nonogram_set_limits(nonogram_solver*, double, uint64_t, size_t);
+NONOGRAM_API void nonogram_set_interrupt(nonogram_solver*, const volatile sig_atomic_t*);
+NONOGRAM_API nonogram_store *nonogram_open_store(const char*);
+NONOGRAM_API void nonogram_close_store(nonogram_store*);
+NONOGRAM_API void nonogram_set_store(nonogram_solver*, nonogram_store*);
+NONOGRAM_API void nonogram_set_progress(nonogram_solver*, double, const volatile sig_atomic_t*, nonogram_progress_callback*, void*);
+NONOGRAM_API nonogram_result nonogram_solve(nonogram_solver*, const nonogram_puzzle*);
+NONOGRAM_API nonogram_result nonogram_solve_lines(nonogram_solver*, const nonogram_puzzle*);
+NONOGRAM_API nonogram_result nonogram_backtrack(nonogram_solver*);
+NONOGRAM_API unsigned int nonogram_unknown_cells(const nonogram_solver*);
+NONOGRAM_API void nonogram_get_picture(const nonogram_solver*, signed char*);
+NONOGRAM_API void nonogram_get_second_picture(const nonogram_solver*, signed char*);
+NONOGRAM_API void nonogram_get_stats(const nonogram_solver*, nonogram_stats*);
+NONOGRAM_API bool nonogram_check_picture(const nonogram_puzzle*, const signed char*);
+
+#endif
+
+/* vim:set ts=2 sts=2 sw=2 et: */
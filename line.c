@@ -0,0 +1,471 @@
+/* Copyright © 2026 Jakub Wilk <jwilk@jwilk.net>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Bit-parallel line solver.
+//
+// A line of n cells is extended with two virtual empty cells, so that bit t
+// of a span stands for cell t - 1, bit 0 and bit n + 1 being the virtual ones.
+// Lines up to 62 cells fit into a single 64-bit word.
+//
+// prefix[j] is the set of t such that blocks 0..j-1 fit into cells 1..t-1,
+// and cell t can be empty. suffix[j] is the set of t such that blocks
+// j..count-1 fit into cells t+1..n, and cell t can be empty. suffix[] is
+// computed as prefix[] of the reversed line.
+
+#include <math.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "line.h"
+#include "memory.h"
+
+#define MAX_COUNT_TABLE (1 << 22) // entries in each count_line() table, at most
+
+#define N_TMP 10
+
+static inline void span_shl(uint64_t *dst, const uint64_t *src, unsigned int shift, unsigned int nw)
+// dst = src << shift
+// (dst == src is allowed)
+{
+  unsigned int i, ws = shift / WORD_BITS, bs = shift % WORD_BITS;
+  uint64_t w;
+  for (i = nw; i-- > 0; )
+  {
+    w = 0;
+    if (i >= ws)
+    {
+      w = src[i - ws] << bs;
+      if (bs > 0 && i > ws)
+        w |= src[i - ws - 1] >> (WORD_BITS - bs);
+    }
+    dst[i] = w;
+  }
+}
+
+static inline void span_shr(uint64_t *dst, const uint64_t *src, unsigned int shift, unsigned int nw)
+// dst = src >> shift
+// (dst == src is allowed)
+{
+  unsigned int i, ws = shift / WORD_BITS, bs = shift % WORD_BITS;
+  uint64_t w;
+  for (i = 0; i < nw; i++)
+  {
+    w = 0;
+    if (i + ws < nw)
+    {
+      w = src[i + ws] >> bs;
+      if (bs > 0 && i + ws + 1 < nw)
+        w |= src[i + ws + 1] << (WORD_BITS - bs);
+    }
+    dst[i] = w;
+  }
+}
+
+static inline void span_fill(uint64_t *dst, const uint64_t *seeds, const uint64_t *mask, unsigned int nw)
+// Propagate every seed upwards, as long as the mask allows.
+// dst[t] = exists s <= t such that seeds[s] and mask[s..t]
+{
+  unsigned int i;
+  uint64_t s, m, sum, c, carry = 0;
+  for (i = 0; i < nw; i++)
+  {
+    m = mask[i];
+    s = seeds[i] & m;
+    sum = m + s;
+    c = sum < m;
+    sum += carry;
+    carry = c | (sum < carry);
+    dst[i] = ((sum ^ m) | s) & m;
+  }
+}
+
+static inline void span_put(uint64_t *span, unsigned int t, bool value)
+{
+  uint64_t bit = UINT64_C(1) << (t % WORD_BITS);
+  if (value)
+    span[t / WORD_BITS] |= bit;
+  else
+    span[t / WORD_BITS] &= ~bit;
+}
+
+static inline void span_trim(uint64_t *span, unsigned int nbits, unsigned int nw)
+// Clear bits beyond nbits.
+{
+  unsigned int i;
+  if (nbits % WORD_BITS != 0)
+    span[nbits / WORD_BITS] &= (UINT64_C(1) << (nbits % WORD_BITS)) - 1;
+  for (i = span_words(nbits); i < nw; i++)
+    span[i] = 0;
+}
+
+static inline void span_load(uint64_t *dst, const uint64_t *src, unsigned int snw, unsigned int start, unsigned int nw)
+// dst = src >> start
+// (src has snw words, dst has nw words)
+{
+  unsigned int i, ws = start / WORD_BITS, bs = start % WORD_BITS;
+  uint64_t w;
+  for (i = 0; i < nw; i++)
+  {
+    w = 0;
+    if (i + ws < snw)
+    {
+      w = src[i + ws] >> bs;
+      if (bs > 0 && i + ws + 1 < snw)
+        w |= src[i + ws + 1] << (WORD_BITS - bs);
+    }
+    dst[i] = w;
+  }
+}
+
+static inline void span_store(uint64_t *dst, unsigned int dnw, const uint64_t *src, unsigned int snw, unsigned int start)
+// dst = src << start
+// (dst has dnw words, src has snw words)
+{
+  unsigned int i, ws = start / WORD_BITS, bs = start % WORD_BITS;
+  uint64_t w;
+  for (i = 0; i < dnw; i++)
+  {
+    w = 0;
+    if (i >= ws && i - ws < snw)
+      w = src[i - ws] << bs;
+    if (bs > 0 && i > ws && i - ws - 1 < snw)
+      w |= src[i - ws - 1] >> (WORD_BITS - bs);
+    dst[i] = w;
+  }
+}
+
+static inline uint64_t reverse_word(uint64_t w)
+{
+  w = ((w >> 1) & UINT64_C(0x5555555555555555)) | ((w & UINT64_C(0x5555555555555555)) << 1);
+  w = ((w >> 2) & UINT64_C(0x3333333333333333)) | ((w & UINT64_C(0x3333333333333333)) << 2);
+  w = ((w >> 4) & UINT64_C(0x0F0F0F0F0F0F0F0F)) | ((w & UINT64_C(0x0F0F0F0F0F0F0F0F)) << 4);
+  w = ((w >> 8) & UINT64_C(0x00FF00FF00FF00FF)) | ((w & UINT64_C(0x00FF00FF00FF00FF)) << 8);
+  w = ((w >> 16) & UINT64_C(0x0000FFFF0000FFFF)) | ((w & UINT64_C(0x0000FFFF0000FFFF)) << 16);
+  return (w >> 32) | (w << 32);
+}
+
+static inline void span_reverse(uint64_t *dst, const uint64_t *src, unsigned int nbits, unsigned int nw)
+// dst[t] = src[nbits - 1 - t]
+// (dst must not overlap src)
+{
+  unsigned int i;
+  for (i = 0; i < nw; i++)
+    dst[i] = reverse_word(src[nw - 1 - i]);
+  span_shr(dst, dst, nw * WORD_BITS - nbits, nw);
+}
+
+static void span_runs(uint64_t *dst, const uint64_t *mask, unsigned int len, uint64_t *tmp, unsigned int nw)
+// dst[t] = mask[t - len + 1] & ... & mask[t]
+// (using O(log len) shifts)
+{
+  unsigned int i, have, power;
+  uint64_t *pw = tmp, *sh = tmp + nw;
+
+  memcpy(pw, mask, nw * sizeof (uint64_t));
+  memset(dst, 0xFF, nw * sizeof (uint64_t));
+  for (have = 0, power = 1; ; power *= 2)
+  {
+    if (len & power)
+    {
+      span_shl(sh, pw, have, nw);
+      for (i = 0; i < nw; i++)
+        dst[i] &= sh[i];
+      have += power;
+    }
+    if (have == len)
+      return;
+    span_shl(sh, pw, power, nw);
+    for (i = 0; i < nw; i++)
+      pw[i] &= sh[i];
+  }
+}
+
+static void span_smear(uint64_t *dst, const uint64_t *src, unsigned int len, uint64_t *tmp, unsigned int nw)
+// dst[t] = src[t - len + 1] | ... | src[t]
+// (using O(log len) shifts)
+{
+  unsigned int i, have, power;
+  uint64_t *pw = tmp, *sh = tmp + nw;
+
+  memcpy(pw, src, nw * sizeof (uint64_t));
+  memset(dst, 0, nw * sizeof (uint64_t));
+  for (have = 0, power = 1; ; power *= 2)
+  {
+    if (len & power)
+    {
+      span_shl(sh, pw, have, nw);
+      for (i = 0; i < nw; i++)
+        dst[i] |= sh[i];
+      have += power;
+    }
+    if (have == len)
+      return;
+    span_shl(sh, pw, power, nw);
+    for (i = 0; i < nw; i++)
+      pw[i] |= sh[i];
+  }
+}
+
+static bool sweep(LineSolver *solver, uint64_t *prefix, const uint64_t *can_empty, const uint64_t *can_fill,
+  unsigned int size, const Clue *blocks, unsigned int count, bool reversed, unsigned int nw)
+// Compute prefix[0..count] for the line.
+// If reversed is true, the blocks are taken in the reverse order.
+// Return false if the blocks don't fit at all.
+{
+  unsigned int i, j, k;
+  uint64_t *seeds = solver->tmp, *runs = seeds + nw, *tmp = runs + nw;
+  uint64_t *row = prefix;
+
+  memset(seeds, 0, nw * sizeof (uint64_t));
+  seeds[0] = 1;
+  span_fill(row, seeds, can_empty, nw);
+  for (j = 0; j < count; j++, row += nw)
+  {
+    k = blocks[reversed ? count - 1 - j : j];
+    span_runs(runs, can_fill, k, tmp, nw);
+    span_shl(runs, runs, 1, nw);
+    span_shl(seeds, row, k + 1, nw);
+    for (i = 0; i < nw; i++)
+      seeds[i] &= runs[i];
+    span_fill(row + nw, seeds, can_empty, nw);
+  }
+  return (row[(size + 1) / WORD_BITS] >> ((size + 1) % WORD_BITS)) & 1;
+}
+
+LineSolver *alloc_line_solver(unsigned int maxsize, unsigned int maxblocks)
+{
+  unsigned int nw = span_words(maxsize + 2);
+  size_t tsize = (size_t)(maxblocks + 1) * nw;
+  LineSolver *tmp = alloc(sizeof (LineSolver));
+  tmp->maxsize = maxsize;
+  tmp->maxblocks = maxblocks;
+  tmp->fcount = tmp->bcount = NULL;
+  tmp->countsize = 0;
+  tmp->ocount = NULL;
+  tmp->prefix = alloc(tsize * sizeof (uint64_t));
+  tmp->suffix = alloc(tsize * sizeof (uint64_t));
+  tmp->rprefix = alloc(tsize * sizeof (uint64_t));
+  tmp->tmp = alloc(N_TMP * nw * sizeof (uint64_t));
+  return tmp;
+}
+
+void free_line_solver(LineSolver *solver)
+{
+  free(solver->prefix);
+  free(solver->suffix);
+  free(solver->rprefix);
+  free(solver->tmp);
+  free(solver->fcount);
+  free(solver->bcount);
+  free(solver->ocount);
+  free(solver);
+}
+
+bool solve_line(LineSolver *solver, const uint64_t *filled, const uint64_t *empty, unsigned int offset, unsigned int size,
+  const Clue *blocks, unsigned int count, uint64_t *rfilled, uint64_t *rempty)
+// Find cells that have the same value in every placement of the blocks.
+//
+// filled and empty are the known cells of the line, one bit per cell.
+// Only cells offset..offset+size-1 are taken into account, and the blocks
+// (count of them) must be placed there.
+// On return, rfilled and rempty are the cells in this range that are always
+// filled and always empty, respectively.
+// Return false if there is no placement at all.
+{
+  unsigned int i, j, k, nbits = size + 2, nw = span_words(nbits);
+  unsigned int inw = span_words(offset + size);
+  uint64_t *can_empty, *can_fill, *rcan_empty, *rcan_fill, *can_x, *can_o;
+  uint64_t *starts, *tmp;
+  uint64_t *prefix = solver->prefix, *suffix = solver->suffix, *rprefix = solver->rprefix;
+
+  can_empty = solver->tmp + 4 * nw;
+  can_fill = can_empty + nw;
+  rcan_empty = can_fill + nw;
+  rcan_fill = rcan_empty + nw;
+  can_x = rcan_fill + nw;
+  can_o = can_x + nw;
+  starts = solver->tmp;
+  tmp = starts + nw;
+
+  span_load(can_fill, empty, inw, offset, nw);
+  span_load(can_empty, filled, inw, offset, nw);
+  for (i = 0; i < nw; i++)
+  {
+    can_fill[i] = ~can_fill[i];
+    can_empty[i] = ~can_empty[i];
+  }
+  span_shl(can_fill, can_fill, 1, nw);
+  span_shl(can_empty, can_empty, 1, nw);
+  span_trim(can_fill, nbits, nw);
+  span_trim(can_empty, nbits, nw);
+  span_put(can_fill, 0, false);
+  span_put(can_fill, size + 1, false);
+  span_put(can_empty, 0, true);
+  span_put(can_empty, size + 1, true);
+
+  if (!sweep(solver, prefix, can_empty, can_fill, size, blocks, count, false, nw))
+    return false;
+  span_reverse(rcan_empty, can_empty, nbits, nw);
+  span_reverse(rcan_fill, can_fill, nbits, nw);
+  if (!sweep(solver, rprefix, rcan_empty, rcan_fill, size, blocks, count, true, nw))
+    return false;
+  for (j = 0; j <= count; j++)
+    span_reverse(suffix + j * nw, rprefix + (count - j) * nw, nbits, nw);
+
+  memset(can_o, 0, nw * sizeof (uint64_t));
+  for (j = 0; j <= count; j++)
+  for (i = 0; i < nw; i++)
+    can_o[i] |= prefix[j * nw + i] & suffix[j * nw + i];
+
+  memset(can_x, 0, nw * sizeof (uint64_t));
+  for (j = 0; j < count; j++)
+  {
+    // block j can start at s if:
+    //   prefix[j] has s - 1,
+    //   cells s..s+k-1 can be filled,
+    //   suffix[j + 1] has s + k.
+    k = blocks[j];
+    span_runs(starts, can_fill, k, tmp, nw);
+    span_shr(starts, starts, k - 1, nw);
+    span_shl(tmp, prefix + j * nw, 1, nw);
+    for (i = 0; i < nw; i++)
+      starts[i] &= tmp[i];
+    span_shr(tmp, suffix + (j + 1) * nw, k, nw);
+    for (i = 0; i < nw; i++)
+      starts[i] &= tmp[i];
+    span_smear(tmp, starts, k, tmp + nw, nw);
+    for (i = 0; i < nw; i++)
+      can_x[i] |= tmp[i];
+  }
+
+  span_shr(can_o, can_o, 1, nw);
+  span_shr(can_x, can_x, 1, nw);
+  for (i = 0; i < nw; i++)
+  {
+    can_o[i] = ~can_o[i];
+    can_x[i] = ~can_x[i];
+  }
+  span_trim(can_o, size, nw);
+  span_trim(can_x, size, nw);
+  span_store(rfilled, inw, can_o, nw, offset);
+  span_store(rempty, inw, can_x, nw, offset);
+  return true;
+}
+
+bool count_line(LineSolver *solver, const uint64_t *filled, const uint64_t *empty, unsigned int offset, unsigned int size,
+  const Clue *blocks, unsigned int count, double *marginals)
+// Count placements of the blocks, like solve_line() does.
+//
+// On return, marginals[i] is the fraction of placements in which the cell
+// offset + i is filled.
+// Return false if there is no placement at all, or there are too many of
+// them to count with doubles, or the line is too long, with too many blocks,
+// to count them without an unreasonably large table.
+{
+  unsigned int j, k, t, width = size + 2;
+  unsigned int *ocount;
+  double *fcount, *bcount, *row, *prev, total, e;
+  size_t tsize = (size_t)(count + 1) * width;
+
+  if (tsize > MAX_COUNT_TABLE)
+    return false;
+  if (solver->countsize < tsize)
+  {
+    free(solver->fcount);
+    free(solver->bcount);
+    solver->fcount = alloc(tsize * sizeof (double));
+    solver->bcount = alloc(tsize * sizeof (double));
+    solver->countsize = tsize;
+  }
+  if (solver->ocount == NULL)
+    solver->ocount = alloc((solver->maxsize + 2) * sizeof (unsigned int));
+  fcount = solver->fcount;
+  bcount = solver->bcount;
+  ocount = solver->ocount;
+
+#define CAN_EMPTY(t) ((t) == 0 || (t) > size || !span_test(filled, offset + (t) - 1))
+#define CAN_FILL(t1, t2) (ocount[t2] == ocount[t1]) // cells t1..t2-1 can be filled
+
+  // ocount[t] is the number of known empty cells among 1..t-1
+  ocount[0] = ocount[1] = 0;
+  for (t = 1; t <= size; t++)
+    ocount[t + 1] = ocount[t] + span_test(empty, offset + t - 1);
+
+  // fcount[j][t]: ways to put blocks 0..j-1 into cells 1..t-1, with cell t empty
+  // bcount[j][t]: ways to put blocks j..count-1 into cells t+1..size, with cell t empty
+  for (t = 0, e = 1.0; t <= size + 1; t++)
+    fcount[t] = e = CAN_EMPTY(t) ? e : 0.0;
+  for (j = 1; j <= count; j++)
+  {
+    row = fcount + (size_t)j * width;
+    prev = row - width;
+    k = blocks[j - 1];
+    for (t = 0; t <= size + 1; t++)
+    {
+      row[t] = 0.0;
+      if (!CAN_EMPTY(t))
+        continue;
+      if (t > 0)
+        row[t] = row[t - 1];
+      if (t > k && CAN_FILL(t - k, t))
+        row[t] += prev[t - k - 1];
+    }
+  }
+  total = fcount[(size_t)count * width + size + 1];
+  if (!(total > 0.0 && total < HUGE_VAL))
+    return false;
+
+  row = bcount + (size_t)count * width;
+  for (t = size + 2, e = 1.0; t-- > 0; )
+    row[t] = e = CAN_EMPTY(t) ? e : 0.0;
+  for (j = count; j-- > 0; )
+  {
+    row = bcount + (size_t)j * width;
+    prev = row + width;
+    k = blocks[j];
+    for (t = size + 2; t-- > 0; )
+    {
+      row[t] = 0.0;
+      if (!CAN_EMPTY(t))
+        continue;
+      if (t <= size)
+        row[t] = row[t + 1];
+      if (t + k + 1 <= size + 1 && CAN_FILL(t + 1, t + k + 1))
+        row[t] += prev[t + k + 1];
+    }
+  }
+
+  // A placement leaves cell t empty for exactly one j:
+  // the number of blocks before t.
+  for (t = 1; t <= size; t++)
+  {
+    for (j = 0, e = 0.0; j <= count; j++)
+      e += fcount[(size_t)j * width + t] * bcount[(size_t)j * width + t];
+    e /= total;
+    marginals[t - 1] = e > 1.0 ? 0.0 : 1.0 - e;
+  }
+#undef CAN_FILL
+#undef CAN_EMPTY
+  return true;
+}
+
+/* vim:set ts=2 sts=2 sw=2 et: */
@@ -0,0 +1,60 @@
+/* Copyright © 2026 Jakub Wilk <jwilk@jwilk.net>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef NONOGRAM_LINE_H
+#define NONOGRAM_LINE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define WORD_BITS 64
+
+typedef uint16_t Clue; // a block length; MAX_SIZE must fit
+
+static inline unsigned int span_words(unsigned int nbits)
+{
+  return (nbits + WORD_BITS - 1) / WORD_BITS;
+}
+
+static inline bool span_test(const uint64_t *span, unsigned int t)
+{
+  return (span[t / WORD_BITS] >> (t % WORD_BITS)) & 1;
+}
+
+typedef struct
+{
+  unsigned int maxsize, maxblocks;
+  uint64_t *prefix, *suffix, *rprefix;
+  uint64_t *tmp;
+  double *fcount, *bcount; // allocated by count_line(), as large as needed so far
+  size_t countsize;        // entries they have room for
+  unsigned int *ocount;
+} LineSolver;
+
+LineSolver *alloc_line_solver(unsigned int, unsigned int);
+void free_line_solver(LineSolver*);
+bool solve_line(LineSolver*, const uint64_t*, const uint64_t*, unsigned int, unsigned int, const Clue*, unsigned int, uint64_t*, uint64_t*);
+bool count_line(LineSolver*, const uint64_t*, const uint64_t*, unsigned int, unsigned int, const Clue*, unsigned int, double*);
+
+#endif
+
+/* vim:set ts=2 sts=2 sw=2 et: */
@@ -38,4 +38,15 @@ void *alloc(size_t size)
   return tmp;
 }
 
+void *reallocate(void *ptr, size_t size)
+{
+  void *tmp = realloc(ptr, size);
+  if (tmp == NULL)
+  {
+    perror(PACKAGE_NAME);
+    abort();
+  }
+  return tmp;
+}
+
 /* vim:set ts=2 sts=2 sw=2 et: */
@@ -23,6 +23,7 @@
 #define NONOGRAM_MEMORY_H
 
 void *alloc(size_t);
+void *reallocate(void*, size_t);
 
 #endif
 
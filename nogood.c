@@ -0,0 +1,182 @@
+/* Copyright © 2026 Jakub Wilk <jwilk@jwilk.net>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Database of nogoods learned while searching.
+//
+// A nogood is a set of literals (cells having values) that cannot all hold
+// at once. Nogoods are stored one after another, starting at word 1, so that
+// 0 can stand for no nogood, and are referred to by where they start. Each
+// one is a header of NOGOOD_HEADER words followed by its literals. The header
+// holds the number of literals, flags, two links that chain together the
+// nogoods watching the same literal (a nogood is watched through its first
+// two literals), and where the latest search for another literal to watch
+// ended, so that the next one can go on from there.
+//
+// Once the budget is used up, the caller is to make room with
+// reduce_nogoods(): the older half of the nogoods is thrown away, except for
+// the permanent ones, and those the caller still refers to, and the rest is
+// moved down.
+//
+// Nogoods are referred to by 32-bit numbers, and so are literals, which is
+// why there can be at most MAX_CELLS cells. The budget is never raised past
+// half of what these can refer to; going past all of it counts as running
+// out of memory.
+
+#include "autoconf.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memory.h"
+#include "nogood.h"
+
+#define PERMANENT 1
+#define KEEP 2 // referred to by the caller, while reducing
+
+static void link_watches(NogoodBase *base, uint32_t ref)
+{
+  Literal *lits = nogood_literals(base, ref);
+  uint32_t *next = nogood_next(base, ref);
+
+  next[0] = base->watches[lits[0]];
+  base->watches[lits[0]] = ref;
+  next[1] = base->watches[lits[1]];
+  base->watches[lits[1]] = ref;
+}
+
+NogoodBase *alloc_nogood_base(unsigned int ncells, size_t budget)
+// Allocate a database for nogoods about ncells cells,
+// aiming at budget bytes for the nogoods themselves.
+{
+  NogoodBase *tmp = alloc(sizeof (NogoodBase));
+  tmp->budget = budget / sizeof (uint32_t);
+  tmp->capacity = 1024;
+  tmp->data = alloc(tmp->capacity * sizeof (uint32_t));
+  tmp->size = 1;
+  tmp->watches = alloc(2 * (size_t)ncells * sizeof (uint32_t));
+  tmp->learned = tmp->deleted = 0;
+  return tmp;
+}
+
+void free_nogood_base(NogoodBase *base)
+{
+  free(base->data);
+  free(base->watches);
+  free(base);
+}
+
+void clear_nogood_base(NogoodBase *base)
+// Forget all nogoods.
+// Only the watches of the nogoods there were are reset,
+// which is much cheaper than resetting all of them for big pictures.
+{
+  Literal *lits;
+  size_t ref;
+
+  for (ref = 1; ref < base->size; ref += NOGOOD_HEADER + nogood_size(base, ref))
+  {
+    lits = nogood_literals(base, ref);
+    base->watches[lits[0]] = base->watches[lits[1]] = NO_NOGOOD;
+  }
+  base->size = 1;
+}
+
+void reduce_nogoods(NogoodBase *base, uint32_t *refs, size_t nrefs)
+// Throw away the nogoods in the older half of the database, except for the
+// permanent ones and those in refs. Move the rest down, updating refs.
+// If what is left still takes up most of the budget, raise the budget,
+// so that this doesn't happen again right away.
+{
+  Literal *lits;
+  size_t k, ref, to, n, size, half = base->size / 2;
+
+  for (k = 0; k < nrefs; k++)
+    base->data[refs[k] + 1] |= KEEP;
+  // Work out where every nogood goes, and note it in its first link;
+  // the links are made anew anyway.
+  to = 1;
+  for (ref = 1; ref < base->size; ref += NOGOOD_HEADER + n)
+  {
+    n = nogood_size(base, ref);
+    lits = nogood_literals(base, ref);
+    base->watches[lits[0]] = base->watches[lits[1]] = NO_NOGOOD;
+    if (ref < half && !(base->data[ref + 1] & (PERMANENT | KEEP)))
+    {
+      nogood_next(base, ref)[0] = NO_NOGOOD;
+      base->deleted++;
+      continue;
+    }
+    nogood_next(base, ref)[0] = to;
+    to += NOGOOD_HEADER + n;
+  }
+  size = to;
+  for (k = 0; k < nrefs; k++)
+    refs[k] = nogood_next(base, refs[k])[0];
+  // Nogoods only move down, so the ones not moved yet are intact.
+  for (ref = 1; ref < base->size; ref += NOGOOD_HEADER + n)
+  {
+    n = nogood_size(base, ref);
+    to = nogood_next(base, ref)[0];
+    if (to == NO_NOGOOD)
+      continue;
+    memmove(base->data + to, base->data + ref, (NOGOOD_HEADER + n) * sizeof (uint32_t));
+    base->data[to + 1] &= ~KEEP;
+    link_watches(base, to);
+  }
+  base->size = size;
+  if (base->size > base->budget / 2)
+    base->budget = base->size < MAX_NOGOOD_WORDS / 4 ? 2 * base->size : MAX_NOGOOD_WORDS / 2;
+}
+
+uint32_t add_nogood(NogoodBase *base, const Literal *lits, unsigned int n, bool permanent)
+// Add the nogood, of at least two literals, watched through the first two.
+// Permanent nogoods are never thrown away.
+// Return where the nogood is.
+{
+  size_t need = NOGOOD_HEADER + n;
+  uint32_t ref;
+
+  if (base->size + need > MAX_NOGOOD_WORDS)
+  {
+    errno = ENOMEM;
+    perror(PACKAGE_NAME);
+    abort();
+  }
+  if (base->size + need > base->capacity)
+  {
+    while (base->size + need > base->capacity)
+      base->capacity *= 2;
+    base->data = reallocate(base->data, base->capacity * sizeof (uint32_t));
+  }
+  ref = base->size;
+  base->data[ref] = n;
+  base->data[ref + 1] = permanent ? PERMANENT : 0;
+  *nogood_cursor(base, ref) = 2;
+  memcpy(nogood_literals(base, ref), lits, n * sizeof (Literal));
+  link_watches(base, ref);
+  base->size += need;
+  base->learned++;
+  return ref;
+}
+
+/* vim:set ts=2 sts=2 sw=2 et: */
@@ -0,0 +1,85 @@
+/* Copyright © 2026 Jakub Wilk <jwilk@jwilk.net>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef NONOGRAM_NOGOOD_H
+#define NONOGRAM_NOGOOD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define NO_NOGOOD 0
+#define NOGOOD_HEADER 5 // words before the literals (see nogood.c)
+#define MAX_NOGOOD_WORDS UINT32_MAX // so that every word can be referred to
+
+typedef uint32_t Literal; // a cell having a value: 2 * cell, plus 1 if filled
+
+typedef struct
+{
+  uint32_t *data;         // the nogoods, one after another (see nogood.c)
+  size_t size, capacity;  // words in use (never over MAX_NOGOOD_WORDS), and allocated
+  size_t budget;          // how many words to keep in use, unless more are needed
+  uint32_t *watches;      // for each literal, the first nogood watching it, or NO_NOGOOD
+  uint64_t learned, deleted;
+} NogoodBase;
+
+static inline Literal make_literal(unsigned int cell, bool filled)
+{
+  return 2 * (Literal)cell + filled;
+}
+
+static inline unsigned int nogood_size(const NogoodBase *base, uint32_t ref)
+{
+  return base->data[ref];
+}
+
+static inline Literal *nogood_literals(const NogoodBase *base, uint32_t ref)
+{
+  return base->data + ref + NOGOOD_HEADER;
+}
+
+static inline uint32_t *nogood_next(const NogoodBase *base, uint32_t ref)
+// Get the links to the next nogoods watching its first and its second literal.
+{
+  return base->data + ref + 2;
+}
+
+static inline uint32_t *nogood_cursor(const NogoodBase *base, uint32_t ref)
+// Get where the latest search for a literal to watch instead ended.
+{
+  return base->data + ref + 4;
+}
+
+static inline bool nogood_base_full(const NogoodBase *base, unsigned int n)
+// Check whether a nogood of n literals would go over the budget.
+{
+  return base->size + NOGOOD_HEADER + n > base->budget;
+}
+
+NogoodBase *alloc_nogood_base(unsigned int, size_t);
+void free_nogood_base(NogoodBase*);
+void clear_nogood_base(NogoodBase*);
+void reduce_nogoods(NogoodBase*, uint32_t*, size_t);
+uint32_t add_nogood(NogoodBase*, const Literal*, unsigned int, bool);
+
+#endif
+
+/* vim:set ts=2 sts=2 sw=2 et: */
@@ -22,25 +22,208 @@
 #ifndef NONOGRAM_H
 #define NONOGRAM_H
 
-#define MAX_SIZE 999
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cache.h"
+#include "libnonogram.h"
+#include "line.h"
+#include "nogood.h"
+#include "queue.h"
+
+#define MAX_SIZE 65535 // so that xsize * ysize fits in an unsigned int
+#define MAX_CELLS (1U << 25) // searching takes some 60 bytes per cell and thread
 #define MAX_FACTOR 10000
 #define MAX_EVIL 15.0
+#define MAX_QUEUE_FACTOR ((int) (MAX_FACTOR * (MAX_EVIL * MAX_EVIL + 1)))
+#define LINE_CACHE_SIZE (16 << 20) // bytes, shared by all threads of a solver
+#define NOGOOD_BASE_SIZE (2 << 20) // bytes of learned nogoods, likewise
+#define MAX_THREADS 256
+#define EXIT_MULTIPLE 2 // what --unique exits with if there are more solutions
+#define EXIT_STOPPED 3  // what we exit with if the solver gave up early
 
 typedef signed char bit;
 #define Q 0
 #define O (-1)
 #define X 1
 
+typedef struct nonogram_puzzle
+{
+  unsigned int xsize, ysize;
+  unsigned int xysize;  // max(xsize, ysize)
+  unsigned int xpysize; // xsize + ysize
+  unsigned int vsize;   // xsize * ysize
+  unsigned int lmax, tmax; // 1 + maximum number of blocks in a row/column
+  unsigned int rowwords;   // words per row in the bitplanes
+  unsigned int colwords;   // words per column in the column bitplanes
+  Clue *clues;         // block lengths of each row, then of each column, as read; each line ends with 0
+  size_t *clueoffset;  // where each line starts in clues; the last one is the total size
+  unsigned int *blockcount;  // number of blocks in each row, then in each column
+  unsigned int *evilcounter;
+} Puzzle;
+
+static inline const Clue *line_clues(const Puzzle *puzzle, unsigned int line)
+// Get the block lengths of the line: a row or, from ysize on, a column.
+{
+  return puzzle->clues + puzzle->clueoffset[line];
+}
+
+static inline unsigned int line_clue(const Puzzle *puzzle, unsigned int line, unsigned int k)
+// Get the k-th number of the line, or 0 if there are fewer numbers.
+{
+  size_t n = puzzle->clueoffset[line] + k;
+  return n < puzzle->clueoffset[line + 1] ? puzzle->clues[n] : 0;
+}
+
 typedef struct
 {
+  unsigned int head, tail;             // number of solved cells at both ends of the line
+  unsigned int headblocks, tailblocks; // number of blocks pinned there
+} LineBounds;
+
+typedef struct
+{
+  unsigned int line;
+  LineBounds bounds;
+} BoundsSave;
+
+typedef struct
+{
+  const Puzzle *puzzle;
   unsigned int counter; // how many Q-fields we have
   unsigned int *linecounter;
-  unsigned int *evilcounter;
-  bit bits[];
+  LineBounds *bounds;
+  uint64_t *filled; // known-filled cells, one bit per cell, each row padded to whole words
+  uint64_t *empty;  // known-empty cells, likewise
+  uint64_t *cfilled, *cempty; // the same, column by column
+  unsigned int *trail; // cells in the order they were set
+  unsigned int trailsize;
+  unsigned int *position; // where each cell is in the trail, if it is there
+  BoundsSave *boundstrail; // previous line bounds, in the order they were changed
+  unsigned int boundstrailsize, boundstrailcap;
+  uint64_t *boundsstamp; // serial number of the decision when bounds of each line were last saved
+  uint64_t serial;       // serial number of the latest decision
 } Picture;
 
-extern unsigned int xsize, ysize, xysize, xpysize, vsize;
-extern unsigned int lmax, tmax;
+typedef struct
+{
+  unsigned int i, j;
+  bit value;
+  bool flipped; // whether the other value was already tried
+  unsigned int trailsize, boundstrailsize; // trail sizes before the decision
+} Decision;
+
+#define NO_LINE UINT_MAX
+
+typedef struct
+{
+  unsigned int start; // where the cells set for this reason start in the trail
+  unsigned int line;  // the line they were deduced from, or NO_LINE
+  uint32_t nogood;    // otherwise, the nogood the cell was deduced from, or NO_NOGOOD for a guess
+} Reason;
+
+typedef struct nonogram_store
+{
+  char *path; // the directory
+} Store;
+
+typedef struct
+{
+  uint16_t *data; // the canonical form of the clues (see store.c)
+  size_t size;
+  uint64_t hash;
+  bool transposed, fliprows, flipcolumns; // how to get from the puzzle to the canonical form
+  unsigned int xsize, ysize; // the size of the puzzle in the canonical form
+} StoreKey;
+
+typedef struct nonogram_solver Solver;
+
+typedef struct
+{
+  unsigned int id;
+  Solver *solver;
+  const Puzzle *puzzle;
+  Picture *picture;
+  Queue *queue;
+  uint64_t *testfield;
+  LineSolver *linesolver;
+  LineCache *linecache;
+  float *rowp; // row marginals, for choose_cell()
+  double *marginals;
+  unsigned int maxsize, maxcells; // what the buffers above are large enough for
+  uint64_t fingercounter;
+  uint64_t linesolves, cells; // touch_line() calls, and cells deduced by them
+  uint64_t probes;   // cells tried tentatively when probing
+  uint64_t nodes;    // guesses made when backtracking
+  uint64_t failures; // contradictions met when backtracking
+  uint64_t learned, backjumps; // nogoods learned from them, and how many times that undid more than one guess
+  unsigned int maxdepth;
+  unsigned int ticks; // calls to should_stop(), for checking the clock only every so often
+  atomic_uint_fast64_t shownfingercounter, shownnodes; // copies of the counters for reporting progress,
+  atomic_uint showndepth, shownmaxdepth, shownunknown; // updated every so often
+  unsigned int roottrailsize, rootboundstrailsize; // trail sizes when the search started
+  bool busy;              // whether the worker has a subtree to explore
+  Decision *stack;        // decisions taken so far
+  unsigned int depth;
+  pthread_mutex_t lock;   // protects stack and depth from other workers
+  NogoodBase *nogoods;    // learned from contradictions, while searching
+  Reason *reasons;        // why the cells in the trail above the root were set
+  unsigned int nreasons, reasonscap;
+  unsigned int nogoodhead; // cells in the trail up to here have been checked against the nogoods
+  unsigned int conflictline;  // the line found to have no placement, or NO_LINE
+  unsigned int conflictstart; // the trail size by then
+  uint32_t conflictnogood;    // otherwise, the nogood found to hold, or NO_NOGOOD
+  unsigned char *seen;    // cells looked at by learn(), for a search
+  unsigned int *buffer;   // a buffer for learn(), likewise
+  Literal *literals;      // likewise
+} Worker;
+
+struct nonogram_solver
+{
+  unsigned int nworkers;
+  Worker **workers;
+  const Puzzle *puzzle;
+  Picture *picture; // the picture of the first worker
+  atomic_bool done; // whether the search is over
+  atomic_uint busy; // how many workers have a subtree to explore
+  Worker *winner;   // the worker that found a solution
+  unsigned int maxsolutions; // how many solutions to look for: 1, or 2 to check uniqueness
+  atomic_uint nsolutions;    // how many were found
+  Picture *solutions[2];     // when checking uniqueness: the first one found in the part searched, and the second solution
+  unsigned int *linecomponent; // the part of the picture each line with unknown cells belongs to, while searching
+  unsigned int ncomponents;    // how many parts the search was split into
+  unsigned int focus;          // the part being searched
+  unsigned int outside;        // how many unknown cells there are in the other parts
+  double timelimit;    // seconds per puzzle, or 0
+  uint64_t maxnodes;   // guesses per puzzle, or 0
+  size_t maxmemory;    // bytes of RSS, or 0
+  const volatile sig_atomic_t *interrupt; // give up when this becomes nonzero, unless NULL
+  double deadline;     // when to give up, by get_time(), or 0
+  atomic_uint_fast64_t nodes; // guesses made so far, by all the workers
+  atomic_bool stopped; // whether the solver gave up
+  Store *store;        // where solutions are looked up and remembered, or NULL
+  StoreKey *storekey;  // the puzzle, as known to the store; made on first use
+  uint64_t storehits, storemisses;
+  double progressinterval; // seconds between progress reports, or 0
+  const volatile sig_atomic_t *progressflag; // report progress when this changes, unless NULL
+  atomic_int progressseen; // the value of *progressflag when progress was last reported
+  nonogram_progress_callback *progresscallback; // where to report it, unless NULL
+  void *progressdata;
+  const char *phase;   // what the solver is doing, for progress reports
+  double started;      // when the solver started on the puzzle, by get_time()
+  double nextreport;   // when to report progress next
+  atomic_flag reporting; // whether a worker is reporting progress right now
+  double lastreport;     // what the previous report said, for computing rates
+  uint64_t lastfingercounter, lastnodes;
+  double preliminarytime, shaketime, probetime, backtracktime; // seconds spent in each phase
+};
+
+typedef nonogram_stats Stats;
+typedef nonogram_progress Progress;
 
 #endif
 
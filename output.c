@@ -0,0 +1,390 @@
+/* Copyright © 2003-2026 Jakub Wilk <jwilk@jwilk.net>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "autoconf.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_GETRUSAGE
+#include <sys/resource.h>
+#endif
+
+#include "config.h"
+#include "memory.h"
+#include "nonogram.h"
+#include "output.h"
+#include "term.h"
+
+typedef struct
+{
+  char *data;
+  size_t size, capacity;
+} Buffer;
+
+typedef struct
+{
+  const char *data;
+  size_t size;
+} Fragment;
+
+static Buffer gbuffer; // the picture being rendered; reused for the next one
+
+static void reserve(Buffer *buffer, size_t size)
+// Make room for at least size more bytes.
+{
+  size_t capacity = buffer->capacity > 0 ? buffer->capacity : 4096;
+
+  if (buffer->size + size <= buffer->capacity)
+    return;
+  while (capacity < buffer->size + size)
+    capacity *= 2;
+  buffer->data = reallocate(buffer->data, capacity);
+  buffer->capacity = capacity;
+}
+
+static inline void put_bytes(Buffer *buffer, const char *data, size_t size)
+{
+  reserve(buffer, size);
+  memcpy(buffer->data + buffer->size, data, size);
+  buffer->size += size;
+}
+
+static inline void put_fragment(Buffer *buffer, Fragment fragment)
+{
+  put_bytes(buffer, fragment.data, fragment.size);
+}
+
+static inline void put_string(Buffer *buffer, const char *s)
+{
+  put_bytes(buffer, s, strlen(s));
+}
+
+static void put_number(Buffer *buffer, unsigned int n, unsigned int width)
+// Like printf("%*u", width, n).
+{
+  char digits[16];
+  unsigned int i = sizeof digits;
+
+  do
+  {
+    digits[--i] = '0' + n % 10;
+    n /= 10;
+  }
+  while (n > 0);
+  while (i > sizeof digits - width)
+    digits[--i] = ' ';
+  put_bytes(buffer, digits + i, sizeof digits - i);
+}
+
+static inline Fragment fragment(const char *s)
+{
+  Fragment tmp = { s, strlen(s) };
+  return tmp;
+}
+
+static char *join(const char *s1, const char *s2, const char *s3)
+{
+  size_t l1 = strlen(s1), l2 = strlen(s2), l3 = strlen(s3);
+  char *tmp = alloc(l1 + l2 + l3 + 1);
+  memcpy(tmp, s1, l1);
+  memcpy(tmp + l1, s2, l2);
+  memcpy(tmp + l1 + l2, s3, l3 + 1);
+  return tmp;
+}
+
+static void flush_buffer(Buffer *buffer)
+// Write the whole picture at once.
+{
+  fwrite(buffer->data, 1, buffer->size, stdout);
+  buffer->size = 0;
+}
+
+static void render_picture_plain(Buffer *buffer, const Puzzle *puzzle, bit *picture, bit *cpicture)
+{
+  unsigned int xsize = puzzle->xsize, ysize = puzzle->ysize;
+  unsigned int lmax = puzzle->lmax, tmax = puzzle->tmax;
+  unsigned int i, j, k, t;
+  char *cells[2][3]; // light, contents, dark; for each column parity and cell value
+  Fragment cell[2][3], light[2], dark, v, h, empty = fragment("  ");
+
+  if (ENABLE_DEBUG && cpicture == NULL)
+    cpicture = picture;
+
+  for (k = 0; k < 2; k++)
+  {
+    cells[k][Q - O] = join(term_strings.light[k], "<>", term_strings.dark);
+    cells[k][O - O] = join(term_strings.light[k], "  ", term_strings.dark);
+    cells[k][X - O] = join(term_strings.light[k], term_strings.hash, term_strings.dark);
+    for (t = 0; t < 3; t++)
+      cell[k][t] = fragment(cells[k][t]);
+    light[k] = fragment(term_strings.light[k]);
+  }
+  dark = fragment(term_strings.dark);
+  v = fragment(term_strings.v);
+  h = fragment(term_strings.h);
+  // Rough upper bound of the size, so that the buffer grows at most once.
+  reserve(buffer, (size_t)(tmax + ysize + 2) * (lmax + xsize + 2) * (cell[1][X - O].size + cell[1][Q - O].size + h.size + 4));
+
+  put_string(buffer, term_strings.init);
+
+  for (i = 0; i < tmax; i++)
+  {
+    put_bytes(buffer, " ", 1);
+    for (j = 0; j < lmax; j++)
+      put_fragment(buffer, empty);
+    for (j = 0; j < xsize; j++)
+    {
+      t = line_clue(puzzle, ysize + j, i);
+      put_fragment(buffer, light[j & 1]);
+      if (t != 0 || i == 0)
+        put_number(buffer, t, 2);
+      else
+        put_fragment(buffer, empty);
+      put_fragment(buffer, dark);
+    }
+    put_bytes(buffer, "\n", 1);
+  }
+
+  for (i = 0; i < lmax; i++)
+    put_fragment(buffer, empty);
+  put_string(buffer, term_strings.tl);
+  for (i = 0; i < xsize; i++)
+    put_fragment(buffer, h);
+  put_string(buffer, term_strings.tr);
+  put_bytes(buffer, "\n", 1);
+  for (i = 0; i < ysize; i++)
+  {
+    for (j = 0; j < lmax; j++)
+    {
+      t = line_clue(puzzle, i, j);
+      put_fragment(buffer, light[j & 1]);
+      if (t != 0 || j == 0)
+        put_number(buffer, t, 2);
+      else
+        put_fragment(buffer, empty);
+      put_fragment(buffer, dark);
+    }
+    put_fragment(buffer, v);
+    for (j = 0; j < xsize; j++)
+    {
+      if (ENABLE_DEBUG && *picture == O && *cpicture == X)
+      {
+        put_string(buffer, term_strings.error);
+        put_bytes(buffer, "..", 2);
+        put_fragment(buffer, dark);
+      }
+      else if (ENABLE_DEBUG && *picture == X && *cpicture == O)
+      {
+        put_string(buffer, term_strings.error);
+        put_string(buffer, term_strings.hash);
+        put_fragment(buffer, dark);
+      }
+      else
+        put_fragment(buffer, cell[j & 1][*picture - O]);
+      picture++;
+      if (ENABLE_DEBUG)
+        cpicture++;
+    }
+    put_fragment(buffer, v);
+    put_bytes(buffer, "\n", 1);
+  }
+  for (i = 0; i < lmax; i++)
+    put_fragment(buffer, empty);
+  put_string(buffer, term_strings.bl);
+  for (i = 0; i < xsize; i++)
+    put_fragment(buffer, h);
+  put_string(buffer, term_strings.br);
+  put_bytes(buffer, "\n\n", 2);
+
+  for (k = 0; k < 2; k++)
+  for (t = 0; t < 3; t++)
+    free(cells[k][t]);
+}
+
+static void render_html_dtd(Buffer *buffer, bool use_xhtml, bool need_charset)
+{
+  if (use_xhtml && need_charset)
+    put_string(buffer, "<?xml version='1.0' encoding='ISO-8859-1'?>\n");
+  put_string(buffer, use_xhtml ?
+    "<!DOCTYPE html PUBLIC '-//W3C//DTD XHTML 1.0 Strict//EN' 'http://www.w3.org/TR/xhtml1/DTD/xhtml1-strict.dtd'>\n" :
+    "<!DOCTYPE html PUBLIC '-//W3C//DTD HTML 4.01//EN' 'http://www.w3.org/TR/html4/strict.dtd'>\n");
+}
+
+static void render_picture_html(Buffer *buffer, const Puzzle *puzzle, bit *picture, bool use_xhtml)
+{
+  unsigned int i, j;
+  unsigned int xsize = puzzle->xsize, ysize = puzzle->ysize;
+  unsigned int lmax = puzzle->lmax, tmax = puzzle->tmax;
+  static const Fragment cells[3] = {
+    [O - O] = { "<td>\xA0</td>", 10 },
+    [Q - O] = { "<td class='v'>?</td>", 20 },
+    [X - O] = { "<td class='x'>#</td>", 20 }
+  };
+  const Fragment blank = fragment("<th>\xA0</th>");
+
+  // Rough upper bound of the size, so that the buffer grows at most once.
+  reserve(buffer, 2048 + (size_t)(tmax + ysize) * (lmax + xsize + 2) * 24);
+
+  render_html_dtd(buffer, use_xhtml, true);
+  put_string(buffer,
+    "<html>\n"
+    "<head>\n"
+    "<title>Nonogram solution</title>\n"
+    "<meta http-equiv='Content-type' content='text/html; charset=ISO-8859-1'");
+  put_string(buffer, use_xhtml ? " /" : "");
+  put_string(buffer, ">\n"
+    "<style type='text/css'>\n"
+    "  table "  "{ border-collapse: collapse; } \n"
+    "  td, th " "{ font: 8pt Arial, sans-serif; width: 11pt; height: 11pt; }\n"
+    "  th "     "{ background-color: #fff; color: #000;"
+                 " border: dotted 1px #888; }\n"
+    "  th.empty  { border: none; }\n"
+    "  td.x "   "{ background-color: #000; color: #000; }\n"
+    "  td.v "   "{ background-color: #888; color: #f00; }\n"
+    "  td "     "{ background-color: #eee; color: #000;"
+                 " border: solid 1px #888; text-align: center; }\n"
+    "</style>\n"
+    "</head>\n"
+    "<body>\n"
+    "<table border='0' cellpadding='0' cellspacing='0'>");
+
+  unsigned int *top_desc_size = alloc(xsize * sizeof (unsigned int));
+  for (i = 0; i < xsize; i++)
+  {
+    top_desc_size[i] = 0;
+    for (j = 0; j < tmax; j++)
+      if (line_clue(puzzle, ysize + i, j) == 0)
+        break;
+      else
+        top_desc_size[i]++;
+  }
+
+  for (i = 0; i < tmax; i++)
+  {
+    put_string(buffer, "<tr>");
+    if (i == 0)
+    {
+      put_string(buffer, "<th class='empty' colspan='");
+      put_number(buffer, lmax, 0);
+      put_string(buffer, "' rowspan='");
+      put_number(buffer, tmax, 0);
+      put_string(buffer, "'>\xA0</th>");
+    }
+    for (j = 0; j < xsize; j++)
+    {
+      if (i < tmax - top_desc_size[j])
+        put_fragment(buffer, blank);
+      else
+      {
+        put_string(buffer, "<th>");
+        put_number(buffer, line_clue(puzzle, ysize + j, i - tmax + top_desc_size[j]), 0);
+        put_string(buffer, "</th>");
+      }
+    }
+    put_string(buffer, "</tr>\n");
+  }
+
+  free(top_desc_size);
+
+  for (i = 0; i < ysize; i++)
+  {
+    put_string(buffer, "<tr>");
+    for (j = 0; j < lmax; j++)
+      if (line_clue(puzzle, i, j) == 0)
+        break;
+    for (; j < lmax; j++)
+      put_fragment(buffer, blank);
+    for (j = 0; j < lmax; j++)
+    {
+      unsigned int t = line_clue(puzzle, i, j);
+      if (t != 0)
+      {
+        put_string(buffer, "<th>");
+        put_number(buffer, t, 0);
+        put_string(buffer, "</th>");
+      }
+    }
+    for (j = 0; j < xsize; j++, picture++)
+      put_fragment(buffer, cells[*picture - O]);
+    put_string(buffer, "</tr>\n");
+  }
+  put_string(buffer, "</table>\n</body>\n</html>\n");
+}
+
+void print_stats(const char *name, unsigned int line, bool solved, const Stats *stats, double parsetime, double outputtime)
+// Print the statistics to stderr, as a single line of key=value pairs.
+// name and line identify the puzzle in batch mode; name is NULL otherwise.
+{
+#ifdef HAVE_GETRUSAGE
+  struct rusage usage;
+#endif
+
+  if (name != NULL)
+    fprintf(stderr, "puzzle=%s:%u ", name, line);
+  fprintf(stderr,
+    "solved=%s stopped=%s parse_time=%.6f preliminary_shake_time=%.6f shake_time=%.6f probe_time=%.6f backtrack_time=%.6f output_time=%.6f "
+    "fingercounter=%ju touch_line_calls=%ju cells_deduced=%ju cells_per_call=%.3f queue_pushes=%ju queue_pops=%ju "
+    "probes=%ju nodes=%ju failures=%ju nogoods_learned=%ju backjumps=%ju max_depth=%u components=%u",
+    solved ? "yes" : "no", stats->stopped ? "yes" : "no", parsetime, stats->preliminary_shake_time, stats->shake_time, stats->probe_time, stats->backtrack_time, outputtime,
+    stats->fingercounter, stats->linesolves, stats->cells,
+    stats->linesolves > 0 ? (double) stats->cells / stats->linesolves : 0.0,
+    stats->pushes, stats->pops,
+    stats->probes, stats->nodes, stats->failures, stats->learned, stats->backjumps, stats->maxdepth, stats->components
+  );
+  if (stats->cache)
+    fprintf(stderr, " cache_hits=%ju cache_misses=%ju", stats->cachehits, stats->cachemisses);
+  if (stats->store)
+    fprintf(stderr, " solution_cache_hits=%ju solution_cache_misses=%ju", stats->storehits, stats->storemisses);
+#ifdef HAVE_GETRUSAGE
+  if (getrusage(RUSAGE_SELF, &usage) == 0)
+    fprintf(stderr, " peak_rss_kb=%ld", (long) usage.ru_maxrss);
+#endif
+  fputc('\n', stderr);
+}
+
+void print_progress(const char *name, unsigned int line, const Progress *progress)
+// Print a progress report to stderr, in the same format as the statistics.
+{
+  if (name != NULL)
+    fprintf(stderr, "puzzle=%s:%u ", name, line);
+  fprintf(stderr,
+    "phase=%s time=%.3f fingercounter=%ju fingercounter_per_second=%.0f "
+    "nodes=%ju nodes_per_second=%.0f depth=%u max_depth=%u unknown_cells=%u\n",
+    progress->phase, progress->time, progress->fingercounter, progress->lines_per_second,
+    progress->nodes, progress->nodes_per_second, progress->depth, progress->maxdepth, progress->unknown
+  );
+}
+
+void print_picture(const Puzzle *puzzle, bit *picture, bit *cpicture)
+// Render the picture into a buffer, then write it in one go.
+{
+  if (config.html)
+    render_picture_html(&gbuffer, puzzle, picture, config.xhtml);
+  else
+    render_picture_plain(&gbuffer, puzzle, picture, cpicture);
+  flush_buffer(&gbuffer);
+  if (!config.html)
+    fflush(stdout);
+}
+
+/* vim:set ts=2 sts=2 sw=2 et: */
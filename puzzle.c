@@ -0,0 +1,247 @@
+/* Copyright © 2003-2026 Jakub Wilk <jwilk@jwilk.net>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "autoconf.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "io.h"
+#include "line.h"
+#include "memory.h"
+#include "nonogram.h"
+#include "puzzle.h"
+
+static double binomln(int n, int k)
+// Return
+//   ln binom(n, k)
+// or +0.0
+{
+  double tmp;
+
+  if (n <= k || n <= 0 || k <= 0)
+    return 0.0;
+
+  double dn = (double)n;
+  double dk = (double)k;
+
+  tmp = -0.5 * log(8 * atan(1)); // atan(1) = π/4
+  tmp += (dn + 0.5) * log(dn);
+  tmp -= (dk + 0.5) * log(dk);
+  tmp -= (dn - dk + 0.5) * log(dn - dk);
+  return tmp;
+}
+
+static unsigned int count_blocks(const Clue *clues)
+{
+  unsigned int n;
+  for (n = 0; clues[n] > 0; n++)
+    ;
+  return n;
+}
+
+static unsigned int measure_evil(int r, int k)
+{
+  double tmp = binomln(r, k);
+  if (tmp > MAX_EVIL)
+    tmp = MAX_EVIL;
+  return floor(tmp * MAX_EVIL * MAX_FACTOR);
+}
+
+static inline unsigned int read_number(Reader *reader, char *c)
+// Read a decimal number, starting with *c; leave the char after it in *c.
+// Numbers too large to be valid are clamped to MAX_SIZE + 1.
+{
+  unsigned int n = 0;
+  while (*c >= '0' && *c <= '9')
+  {
+    if (n <= MAX_SIZE)
+      n = n * 10 + (*c - '0');
+    *c = next_char(reader);
+  }
+  return n > MAX_SIZE ? MAX_SIZE + 1 : n;
+}
+
+static void add_clue(Puzzle *puzzle, size_t *size, size_t *capacity, unsigned int k)
+{
+  if (*size == *capacity)
+  {
+    *capacity = *capacity > 0 ? 2 * *capacity : 2 * (size_t)puzzle->xpysize;
+    puzzle->clues = reallocate(puzzle->clues, *capacity * sizeof(Clue));
+  }
+  puzzle->clues[(*size)++] = k;
+}
+
+static Puzzle *alloc_puzzle(unsigned int xsize, unsigned int ysize)
+{
+  Puzzle *tmp = alloc(sizeof(Puzzle));
+  tmp->xsize = xsize;
+  tmp->ysize = ysize;
+  tmp->vsize = xsize * ysize;
+  tmp->xpysize = xsize + ysize;
+  tmp->xysize = xsize > ysize ? xsize : ysize; // max(xsize, ysize)
+  tmp->rowwords = span_words(xsize);
+  tmp->colwords = span_words(ysize);
+  tmp->clueoffset = alloc((tmp->xpysize + 1) * sizeof(size_t));
+  tmp->blockcount = alloc(tmp->xpysize * sizeof(unsigned int));
+  tmp->evilcounter = alloc(tmp->xpysize * sizeof(unsigned int));
+  return tmp;
+}
+
+void free_puzzle(Puzzle *puzzle)
+{
+  free(puzzle->clues);
+  free(puzzle->clueoffset);
+  free(puzzle->blockcount);
+  free(puzzle->evilcounter);
+  free(puzzle);
+}
+
+Puzzle *read_puzzle(Reader *reader, unsigned int *where)
+// Read the next puzzle.
+// *where is set to the line the puzzle starts at,
+// or, if the input is invalid, to the offending line.
+// Return NULL at the end of the file (setting *where to 0),
+// or if the input is invalid.
+// Anything after the puzzle is left unread.
+{
+  char c;
+  unsigned int xsize, ysize, i, j, k, sane, rowline;
+  unsigned int evs, evm;
+  size_t nclues = 0, cluecap = 0;
+  Puzzle *puzzle;
+
+  *where = 0;
+  do
+    c = next_char(reader);
+  while (c != '\0' && c <= ' ');
+  if (c == '\0')
+    return NULL;
+
+  *where = rowline = reader->line;
+  xsize = read_number(reader, &c);
+  while (c == ' ' || c == '\t')
+    c = next_char(reader);
+  ysize = read_number(reader, &c);
+  while (c != '\0' && c <= ' ')
+    c = next_char(reader);
+
+  if (xsize < 1 || ysize < 1 || xsize > MAX_SIZE || ysize > MAX_SIZE || xsize * ysize > MAX_CELLS)
+  {
+    *where = rowline;
+    return NULL;
+  }
+
+  puzzle = alloc_puzzle(xsize, ysize);
+
+  evs = evm = 0;
+  sane = -1U;
+  puzzle->lmax = 0;
+  rowline = reader->line;
+  for (i = j = 0; i < ysize; )
+  {
+    k = read_number(reader, &c);
+    sane += k + 1;
+    if ((sane>xsize) || (k == 0 && j > 0))
+    {
+      *where = rowline;
+      free_puzzle(puzzle);
+      return NULL;
+    }
+    if (j == 0)
+      puzzle->clueoffset[i] = nclues;
+    add_clue(puzzle, &nclues, &cluecap, k);
+    evs += k;
+    if (k > evm)
+      evm = k;
+    while (c == ' ' || c == '\t')
+      c = next_char(reader);
+    if (c == '\r' || c == '\n' || c == '\0')
+    {
+      add_clue(puzzle, &nclues, &cluecap, 0);
+      if (j > puzzle->lmax)
+        puzzle->lmax = j;
+      puzzle->evilcounter[i] = measure_evil(xsize - evs + 1, j + 1);
+      evs = evm = 0;
+      i++;
+      j = 0;
+      sane = -1U;
+      do
+        c = next_char(reader);
+      while (c == '\r' || c == '\n');
+      rowline = reader->line;
+    }
+    else
+      j++;
+  }
+
+  puzzle->tmax = 0;
+  for (i = j = 0; i < xsize; )
+  {
+    k = read_number(reader, &c);
+    sane += k + 1;
+    if ((sane > ysize) || (k == 0 && j > 0))
+    {
+      *where = rowline;
+      free_puzzle(puzzle);
+      return NULL;
+    }
+    if (j == 0)
+      puzzle->clueoffset[ysize + i] = nclues;
+    add_clue(puzzle, &nclues, &cluecap, k);
+    evs += k;
+    if (k > evm)
+      evm = k;
+    while (c == ' ' || c == '\t')
+      c = next_char(reader);
+    if (c == '\r' || c == '\n' || c == '\0')
+    {
+      add_clue(puzzle, &nclues, &cluecap, 0);
+      if (j > puzzle->tmax)
+        puzzle->tmax = j;
+      puzzle->evilcounter[ysize + i] = measure_evil(ysize - evs + 1, j + 1);
+      evs = evm = 0;
+      i++;
+      j = 0;
+      sane = -1U;
+      if (i < xsize)
+      {
+        do
+          c = next_char(reader);
+        while (c=='\r' || c=='\n');
+        rowline = reader->line;
+      }
+    }
+    else
+      j++;
+  }
+
+  puzzle->lmax++;
+  puzzle->tmax++;
+
+  puzzle->clueoffset[puzzle->xpysize] = nclues;
+  puzzle->clues = reallocate(puzzle->clues, nclues * sizeof(Clue));
+  for (i = 0; i < puzzle->xpysize; i++)
+    puzzle->blockcount[i] = count_blocks(line_clues(puzzle, i));
+  return puzzle;
+}
+
+/* vim:set ts=2 sts=2 sw=2 et: */
@@ -28,49 +28,156 @@
 #include "nonogram.h"
 #include "queue.h"
 
-static inline void update_queue_enq(Queue *queue, unsigned int i)
+// A two-level bucket queue, which serves ids in exact order of their factors.
+//
+// Factors that differ only in the low "shift" bits share a coarse bucket, in
+// no particular order. The lowest non-empty coarse bucket is spread over
+// QUEUE_FINE fine buckets, one per factor, and ids are served from these.
+// Enqueueing an id below that bucket puts its ids back first. Two-level
+// bitmaps of non-empty buckets let get_from_queue() find the lowest one in
+// O(1). Ids with equal factors are served in FIFO order.
+
+static inline unsigned int coarse_bucket(const Queue *queue, int factor)
 {
-  assert(i < queue->size);
-  queue->enqueued[queue->elements[i].id] = i;
+  if (factor < 0)
+    return 0;
+  factor >>= queue->shift;
+  if (factor >= QUEUE_BUCKETS)
+    return QUEUE_BUCKETS - 1;
+  return factor;
 }
 
-static void heapify_queue(Queue *queue)
+static inline unsigned int queue_bucket(const Queue *queue, int factor)
 {
-  unsigned int i, l, r, max;
-  QueueItem ivalue;
+  unsigned int c = coarse_bucket(queue, factor);
+  int f;
+
+  if (c != queue->low)
+    return c;
+  f = factor - (int)(c << queue->shift);
+  if (f < 0)
+    return QUEUE_BUCKETS;
+  if (f >= QUEUE_FINE)
+    return QUEUE_BUCKETS + QUEUE_FINE - 1;
+  return QUEUE_BUCKETS + f;
+}
 
-  i = 0;
-  while (true)
+static inline void mark_bucket(Queue *queue, unsigned int b)
+{
+  queue->used[b / 64] |= (uint64_t)1 << (b % 64);
+  if (b < QUEUE_BUCKETS)
+    queue->summary |= (uint64_t)1 << (b / 64);
+  else
+    queue->finesummary |= (uint64_t)1 << (b / 64 - QUEUE_BUCKETS / 64);
+}
+
+static inline void unmark_bucket(Queue *queue, unsigned int b)
+{
+  queue->used[b / 64] &= ~((uint64_t)1 << (b % 64));
+  if (queue->used[b / 64] != 0)
+    return;
+  if (b < QUEUE_BUCKETS)
+    queue->summary &= ~((uint64_t)1 << (b / 64));
+  else
+    queue->finesummary &= ~((uint64_t)1 << (b / 64 - QUEUE_BUCKETS / 64));
+}
+
+static inline void link_queue(Queue *queue, unsigned int id, unsigned int b)
+{
+  queue->bucket[id] = b;
+  queue->next[id] = -1U;
+  if (queue->head[b] == -1U)
   {
-    ivalue = queue->elements[i];
-    l = 2 * i + 1;
-    r = l + 1;
-    max = (l < queue->size && queue->elements[l].factor > ivalue.factor) ? l : i;
-    if (r < queue->size && queue->elements[r].factor > queue->elements[max].factor)
-      max = r;
-    if (max != i)
-    {
-      queue->elements[i] = queue->elements[max];
-      queue->elements[max] = ivalue;
-      update_queue_enq(queue, i);
-      update_queue_enq(queue, max);
-      i = max;
-    }
-    else
-      return;
+    queue->head[b] = id;
+    queue->prev[id] = -1U;
+    mark_bucket(queue, b);
+  }
+  else
+  {
+    queue->next[queue->tail[b]] = id;
+    queue->prev[id] = queue->tail[b];
   }
+  queue->tail[b] = id;
+}
+
+static inline void unlink_queue(Queue *queue, unsigned int id)
+{
+  unsigned int b = queue->bucket[id];
+  unsigned int next = queue->next[id], prev = queue->prev[id];
+  if (prev == -1U)
+    queue->head[b] = next;
+  else
+    queue->next[prev] = next;
+  if (next == -1U)
+    queue->tail[b] = prev;
+  else
+    queue->prev[next] = prev;
+  if (queue->head[b] == -1U)
+    unmark_bucket(queue, b);
+  queue->bucket[id] = -1U;
 }
 
-Queue *alloc_queue(void)
+static inline unsigned int lowest_bucket(const Queue *queue, uint64_t summary, unsigned int offset)
+// Find the lowest non-empty bucket among those whose bits are in the summary,
+// the first of which is in word offset of the bitmap.
+{
+  unsigned int w = offset + __builtin_ctzll(summary);
+  return w * 64 + __builtin_ctzll(queue->used[w]);
+}
+
+static void move_bucket(Queue *queue, unsigned int b)
+// Put the ids of the bucket where they belong now.
+{
+  unsigned int id, next;
+
+  id = queue->head[b];
+  queue->head[b] = -1U;
+  unmark_bucket(queue, b);
+  for (; id != -1U; id = next)
+  {
+    next = queue->next[id];
+    link_queue(queue, id, queue_bucket(queue, queue->factor[id]));
+  }
+}
+
+static void spread_lowest(Queue *queue)
+// Spread the lowest non-empty coarse bucket over the fine ones.
+{
+  queue->low = lowest_bucket(queue, queue->summary, 0);
+  move_bucket(queue, queue->low);
+}
+
+static void gather_fine(Queue *queue)
+// Put the ids in the fine buckets back into their coarse bucket.
+{
+  queue->low = -1U;
+  while (queue->finesummary != 0)
+    move_bucket(queue, lowest_bucket(queue, queue->finesummary, QUEUE_BUCKETS / 64));
+}
+
+Queue *alloc_queue(unsigned int capacity)
+// Allocate a queue for ids from 0 to capacity - 1,
+// and factors from 0 to MAX_QUEUE_FACTOR.
 {
   Queue *tmp =
     alloc(
       offsetof(Queue, space) +
-      xpysize * (sizeof(unsigned int*) + sizeof(QueueItem)) );
+      4 * capacity * sizeof(unsigned int) );
+  tmp->capacity = capacity;
   tmp->size = 0;
-  tmp->enqueued = (unsigned int*)tmp->space;
-  memset(tmp->enqueued, -1, sizeof(unsigned int*) * xpysize);
-  tmp->elements = (QueueItem*)(tmp->space + xpysize * sizeof(unsigned int));
+  for (tmp->shift = 0; (MAX_QUEUE_FACTOR >> tmp->shift) >= QUEUE_BUCKETS; tmp->shift++)
+    ;
+  assert(1 << tmp->shift <= QUEUE_FINE);
+  tmp->low = -1U;
+  tmp->pushes = tmp->pops = 0;
+  tmp->bucket = (unsigned int*)tmp->space;
+  tmp->next = tmp->bucket + capacity;
+  tmp->prev = tmp->next + capacity;
+  tmp->factor = (int*)(tmp->prev + capacity);
+  memset(tmp->bucket, -1, sizeof(unsigned int) * capacity);
+  memset(tmp->head, -1, sizeof tmp->head);
+  memset(tmp->used, 0, sizeof tmp->used);
+  tmp->summary = tmp->finesummary = 0;
   return tmp;
 }
 
@@ -79,56 +186,63 @@ void free_queue(Queue *queue)
   free(queue);
 }
 
+void clear_queue(Queue *queue)
+{
+  unsigned int w, b, id;
+  uint64_t used;
+  for (w = 0; w < QUEUE_WORDS; w++)
+  {
+    for (used = queue->used[w]; used != 0; used &= used - 1)
+    {
+      b = w * 64 + __builtin_ctzll(used);
+      for (id = queue->head[b]; id != -1U; id = queue->next[id])
+        queue->bucket[id] = -1U;
+      queue->head[b] = -1U;
+    }
+    queue->used[w] = 0;
+  }
+  queue->summary = queue->finesummary = 0;
+  queue->low = -1U;
+  queue->size = 0;
+}
+
 bool is_queue_empty(Queue *queue)
 {
   return queue->size == 0;
 }
 
 bool put_into_queue(Queue *queue, unsigned int id, int factor)
+// Enqueue the id, or move it forward if its factor decreased.
+// Lower factors are served first.
 {
-  unsigned int i, j;
-
-  factor = -factor;
-
-  assert(id < xpysize);
-  i = queue->enqueued[id];
-  if (i == -1U)
-    i = queue->size++;
+  assert(id < queue->capacity);
+  if (queue->bucket[id] == -1U)
+    queue->size++;
   else
   {
-    assert(i < queue->size);
-    if (factor <= queue->elements[i].factor)
+    if (factor >= queue->factor[id])
       return false;
+    unlink_queue(queue, id);
   }
-
-  while (i > 0 && queue->elements[j = (i-1)/2].factor < factor)
-  {
-    queue->elements[i] = queue->elements[j];
-    update_queue_enq(queue, i);
-    i = j;
-  }
-
-  queue->elements[i].id = id;
-  queue->elements[i].factor = factor;
-  update_queue_enq(queue, i);
-
+  if (queue->low != -1U && coarse_bucket(queue, factor) < queue->low)
+    gather_fine(queue);
+  queue->factor[id] = factor;
+  link_queue(queue, id, queue_bucket(queue, factor));
+  queue->pushes++;
   return true;
 }
 
 unsigned int get_from_queue(Queue *queue)
 {
-  unsigned int resultid, last;
+  unsigned int id;
   assert(queue->size > 0);
-  resultid = queue->elements[0].id;
-  last = --queue->size;
-  if (queue->size > 0)
-  {
-    queue->elements[0] = queue->elements[last];
-    update_queue_enq(queue, 0);
-    heapify_queue(queue);
-  }
-  queue->enqueued[resultid] = -1U;
-  return resultid;
+  queue->pops++;
+  queue->size--;
+  if (queue->finesummary == 0)
+    spread_lowest(queue);
+  id = queue->head[lowest_bucket(queue, queue->finesummary, QUEUE_BUCKETS / 64)];
+  unlink_queue(queue, id);
+  return id;
 }
 
 /* vim:set ts=2 sts=2 sw=2 et: */
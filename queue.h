@@ -23,23 +23,31 @@
 #define NONOGRAM_QUEUE_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
-typedef struct
-{
-  unsigned int id;
-  int factor;
-} QueueItem;
+#define QUEUE_BUCKETS 4096 // coarse ones
+#define QUEUE_FINE 1024    // fine ones, for the lowest coarse bucket
+#define QUEUE_WORDS ((QUEUE_BUCKETS + QUEUE_FINE) / 64)
 
 typedef struct
 {
+  unsigned int capacity;
   unsigned int size;
-  unsigned int *enqueued;
-  QueueItem *elements;
+  unsigned int shift; // how many low bits of factors the coarse buckets ignore
+  unsigned int low;   // the coarse bucket spread over the fine ones, or -1U
+  uint64_t pushes, pops;
+  int *factor;
+  unsigned int *bucket; // -1U if not enqueued
+  unsigned int *next, *prev;
+  uint64_t summary, finesummary;
+  uint64_t used[QUEUE_WORDS];
+  unsigned int head[QUEUE_BUCKETS + QUEUE_FINE], tail[QUEUE_BUCKETS + QUEUE_FINE];
   char space[];
 } Queue;
 
-Queue *alloc_queue(void);
+Queue *alloc_queue(unsigned int);
 void free_queue(Queue*);
+void clear_queue(Queue*);
 bool is_queue_empty(Queue*);
 bool put_into_queue(Queue*, unsigned int, int);
 unsigned int get_from_queue(Queue*);
@@ -0,0 +1,549 @@
+/* Copyright © 2026 Jakub Wilk <jwilk@jwilk.net>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "autoconf.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef HAVE_UNIX_SOCKETS
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#endif
+#include <unistd.h>
+
+#include "config.h"
+#include "libnonogram.h"
+#include "memory.h"
+#include "nonogram.h"
+#include "serve.h"
+#include "timer.h"
+
+#ifdef HAVE_UNIX_SOCKETS
+
+// Clues take at most about as many characters as the cells of their line,
+// so no valid puzzle is much longer than two bytes per cell.
+#define MAX_REQUEST_SIZE (2 * (size_t) MAX_CELLS + 16 * (size_t) MAX_SIZE)
+#define READ_CHUNK (64 << 10) // bytes of a request to make room for at a time
+
+typedef struct
+{
+  char *data;
+  size_t size, capacity;
+} Message;
+
+typedef struct
+{
+  uint64_t connections;
+  uint64_t requests; // puzzles received, including invalid ones
+  uint64_t solved, inconsistent, stopped, invalid;
+  double latency, maxlatency; // seconds from receiving a puzzle to sending the answer: in total, and at most
+  uint64_t storehits, storemisses;
+} Counters;
+
+static int glistener;
+static int *gclients; // the connection each thread is serving, or -1
+static bool gclosing;
+static double gstarted;
+static Counters gcounters;
+static pthread_mutex_t glock = PTHREAD_MUTEX_INITIALIZER; // protects everything above but glistener
+static const volatile sig_atomic_t *ginterrupted;
+static nonogram_store *gstore;
+
+static void report_error(const char *what)
+{
+  fprintf(stderr, "%s: %s: %s\n", PACKAGE_NAME, what, strerror(errno));
+}
+
+static bool grow(Message *message, size_t size)
+// Make room for at least size more bytes.
+// Return false if there's no memory for that.
+{
+  size_t capacity = message->capacity > 0 ? message->capacity : 4096;
+  char *data;
+
+  if (message->size + size <= message->capacity)
+    return true;
+  while (capacity < message->size + size)
+    capacity *= 2;
+  data = realloc(message->data, capacity);
+  if (data == NULL)
+    return false;
+  message->data = data;
+  message->capacity = capacity;
+  return true;
+}
+
+static void reserve(Message *message, size_t size)
+// Make room for at least size more bytes, aborting if that's not possible.
+{
+  if (!grow(message, size))
+  {
+    perror(PACKAGE_NAME);
+    abort();
+  }
+}
+
+static void put_string(Message *message, const char *s)
+{
+  size_t size = strlen(s);
+  reserve(message, size);
+  memcpy(message->data + message->size, s, size);
+  message->size += size;
+}
+
+static void put_picture(Message *message, const bit *cells, unsigned int width, unsigned int height)
+// One line per row: # for filled cells, . for empty, ? for unknown ones.
+{
+  unsigned int i, j;
+  char *p;
+
+  reserve(message, (size_t)(width + 1) * height);
+  p = message->data + message->size;
+  for (i = 0; i < height; i++)
+  {
+    for (j = 0; j < width; j++, cells++)
+      *p++ = *cells == X ? '#' : *cells == O ? '.' : '?';
+    *p++ = '\n';
+  }
+  message->size = p - message->data;
+}
+
+static bool read_fully(int fd, char *data, size_t size)
+{
+  ssize_t n;
+
+  while (size > 0)
+  {
+    n = read(fd, data, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+static bool write_fully(int fd, const char *data, size_t size)
+{
+  ssize_t n;
+
+  while (size > 0)
+  {
+    n = write(fd, data, size);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      return false;
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+static int read_message(int fd, Message *message)
+// Read a 4-byte big-endian length, and then that many bytes.
+// Room is made for them as they come, so a length alone takes no memory.
+// Return 1 if that worked, 0 at the end of the connection,
+// or -1 if the message is too large, or there's no memory for it.
+{
+  unsigned char header[4];
+  uint32_t size;
+  size_t n;
+
+  if (!read_fully(fd, (char*) header, sizeof header))
+    return 0;
+  size = (uint32_t) header[0] << 24 | (uint32_t) header[1] << 16 | (uint32_t) header[2] << 8 | header[3];
+  if (size > MAX_REQUEST_SIZE)
+    return -1;
+  message->size = 0;
+  while (message->size < size)
+  {
+    n = size - message->size < READ_CHUNK ? size - message->size : READ_CHUNK;
+    if (!grow(message, n))
+      return -1;
+    if (!read_fully(fd, message->data + message->size, n))
+      return 0;
+    message->size += n;
+  }
+  return 1;
+}
+
+static bool write_message(int fd, const Message *message)
+// Write the message in the same format.
+// Return false if the connection is gone, or if the message is too large.
+{
+  unsigned char header[4];
+  uint32_t size = message->size;
+
+  if (message->size > UINT32_MAX)
+    return false;
+  header[0] = size >> 24;
+  header[1] = size >> 16;
+  header[2] = size >> 8;
+  header[3] = size;
+  return write_fully(fd, (const char*) header, sizeof header) && write_fully(fd, message->data, message->size);
+}
+
+static void put_counters(Message *message)
+{
+  char line[512];
+  Counters counters;
+  double uptime;
+
+  pthread_mutex_lock(&glock);
+  counters = gcounters;
+  uptime = get_time() - gstarted;
+  pthread_mutex_unlock(&glock);
+  snprintf(line, sizeof line,
+    "uptime=%.3f connections=%ju requests=%ju solved=%ju inconsistent=%ju stopped=%ju invalid=%ju "
+    "requests_per_second=%.3f mean_latency=%.6f max_latency=%.6f",
+    uptime, counters.connections, counters.requests,
+    counters.solved, counters.inconsistent, counters.stopped, counters.invalid,
+    uptime > 0 ? counters.requests / uptime : 0.0,
+    counters.requests > 0 ? counters.latency / counters.requests : 0.0,
+    counters.maxlatency
+  );
+  put_string(message, line);
+  if (gstore != NULL)
+  {
+    snprintf(line, sizeof line, " solution_cache_hits=%ju solution_cache_misses=%ju",
+      counters.storehits, counters.storemisses);
+    put_string(message, line);
+  }
+  put_string(message, "\n");
+}
+
+static uint64_t *solve_request(nonogram_solver *solver, const Message *request, Message *response, bit **cells, size_t *ncells)
+// Solve the puzzle, and put the status line and the picture(s) in the response.
+// Return the counter the outcome is to be added to.
+{
+  nonogram_reader *reader;
+  nonogram_puzzle *puzzle;
+  nonogram_result result;
+  unsigned int line, width, height;
+  uint64_t *counter;
+
+  reader = nonogram_open_buffer(request->data, request->size);
+  puzzle = nonogram_read_puzzle(reader, &line);
+  nonogram_close_reader(reader);
+  if (puzzle == NULL)
+  {
+    put_string(response, "invalid input\n");
+    return &gcounters.invalid;
+  }
+  width = nonogram_puzzle_width(puzzle);
+  height = nonogram_puzzle_height(puzzle);
+  if (*ncells < (size_t) width * height)
+  {
+    *ncells = (size_t) width * height;
+    free(*cells);
+    *cells = alloc(*ncells * sizeof(bit));
+  }
+  result = nonogram_solve(solver, puzzle);
+  switch (result)
+  {
+  case NONOGRAM_INCONSISTENT:
+    put_string(response, config.unique ? "none\n" : "inconsistent\n");
+    counter = &gcounters.inconsistent;
+    break;
+  case NONOGRAM_STOPPED:
+    put_string(response, config.unique ? "unknown\n" : "stopped\n");
+    counter = &gcounters.stopped;
+    break;
+  case NONOGRAM_MULTIPLE:
+    put_string(response, "multiple\n");
+    counter = &gcounters.solved;
+    break;
+  default:
+    put_string(response, config.unique ? "unique\n" : "solved\n");
+    counter = &gcounters.solved;
+  }
+  if (result != NONOGRAM_INCONSISTENT)
+  {
+    nonogram_get_picture(solver, *cells);
+    put_picture(response, *cells, width, height);
+  }
+  if (result == NONOGRAM_MULTIPLE)
+  {
+    nonogram_get_second_picture(solver, *cells);
+    put_string(response, "\n");
+    put_picture(response, *cells, width, height);
+  }
+  nonogram_free_puzzle(puzzle);
+  return counter;
+}
+
+static void serve_client(nonogram_solver *solver, int fd)
+// Answer requests until the client hangs up.
+// An empty request asks for the counters; anything else is a puzzle.
+{
+  Message request = { NULL, 0, 0 }, response = { NULL, 0, 0 };
+  bit *cells = NULL;
+  size_t ncells = 0;
+  uint64_t *counter;
+  nonogram_stats stats = { .storehits = 0, .storemisses = 0 };
+  double t, latency;
+  bool ok = true;
+  int rc;
+
+  while (ok && (rc = read_message(fd, &request)) != 0)
+  {
+    response.size = 0;
+    if (rc < 0)
+    {
+      // The rest of the request can't be told apart from the next one,
+      // so that's the end of the connection.
+      put_string(&response, "invalid input\n");
+      write_message(fd, &response);
+      pthread_mutex_lock(&glock);
+      gcounters.invalid++;
+      gcounters.requests++;
+      pthread_mutex_unlock(&glock);
+      break;
+    }
+    if (request.size == 0)
+    {
+      put_counters(&response);
+      ok = write_message(fd, &response);
+      continue;
+    }
+    t = get_time();
+    counter = solve_request(solver, &request, &response, &cells, &ncells);
+    ok = write_message(fd, &response);
+    latency = get_time() - t;
+    if (counter != &gcounters.invalid)
+      nonogram_get_stats(solver, &stats);
+    pthread_mutex_lock(&glock);
+    if (counter != &gcounters.invalid)
+    {
+      gcounters.storehits += stats.storehits;
+      gcounters.storemisses += stats.storemisses;
+    }
+    (*counter)++;
+    gcounters.requests++;
+    gcounters.latency += latency;
+    if (latency > gcounters.maxlatency)
+      gcounters.maxlatency = latency;
+    pthread_mutex_unlock(&glock);
+  }
+  free(request.data);
+  free(response.data);
+  free(cells);
+}
+
+static void *run_thread(void *arg)
+// Take connections, one at a time, until the server is closing.
+// The solver (and its buffers) is kept warm between them.
+{
+  unsigned int id = (uintptr_t) arg;
+  nonogram_solver *solver = nonogram_solver_create(config.threads);
+  int fd;
+
+  nonogram_set_unique(solver, config.unique);
+  nonogram_set_limits(solver, config.time_limit, config.node_limit, config.memory_limit);
+  nonogram_set_interrupt(solver, ginterrupted);
+  nonogram_set_store(solver, gstore);
+  while (true)
+  {
+    fd = accept(glistener, NULL, NULL);
+    if (fd < 0 && (errno == EINTR || errno == ECONNABORTED))
+      continue;
+    pthread_mutex_lock(&glock);
+    if (fd >= 0 && gclosing)
+    {
+      close(fd);
+      fd = -1;
+    }
+    gclients[id] = fd;
+    if (fd >= 0)
+      gcounters.connections++;
+    pthread_mutex_unlock(&glock);
+    if (fd < 0)
+      break;
+    serve_client(solver, fd);
+    pthread_mutex_lock(&glock);
+    gclients[id] = -1;
+    pthread_mutex_unlock(&glock);
+    close(fd);
+  }
+  nonogram_solver_destroy(solver);
+  return NULL;
+}
+
+static bool is_stale(const struct sockaddr_un *addr)
+// Check whether the path is a socket nobody is listening on.
+{
+  struct stat st;
+  int fd;
+  bool stale;
+
+  if (lstat(addr->sun_path, &st) < 0 || !S_ISSOCK(st.st_mode))
+    return false;
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return false;
+  stale = connect(fd, (const struct sockaddr*) addr, sizeof *addr) < 0 && errno == ECONNREFUSED;
+  close(fd);
+  return stale;
+}
+
+static int open_listener(const char *path)
+// Create the socket, replacing a stale one left by a server that's gone.
+{
+  struct sockaddr_un addr;
+  int fd, error;
+
+  if (strlen(path) >= sizeof addr.sun_path)
+  {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+  memset(&addr, 0, sizeof addr);
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+  if (bind(fd, (struct sockaddr*) &addr, sizeof addr) < 0)
+  {
+    error = errno;
+    if (error == EADDRINUSE && is_stale(&addr) && unlink(path) == 0)
+      error = bind(fd, (struct sockaddr*) &addr, sizeof addr) < 0 ? errno : 0;
+    if (error != 0)
+    {
+      close(fd);
+      errno = error;
+      return -1;
+    }
+  }
+  if (listen(fd, SOMAXCONN) < 0)
+  {
+    close(fd);
+    unlink(path);
+    return -1;
+  }
+  return fd;
+}
+
+int run_server(const char *path, nonogram_store *store, const volatile sig_atomic_t *interrupted, const volatile sig_atomic_t *report)
+// Serve puzzles over the Unix domain socket, config.jobs connections at a time,
+// until SIGINT or SIGTERM. On SIGUSR1, print the counters to stderr.
+// Solutions are looked up in, and added to, the store, unless it's NULL.
+//
+// Both requests and responses are a 4-byte big-endian length followed by
+// that many bytes. A request is a puzzle, or empty to ask for the counters.
+// See solve_request() for what the response to a puzzle looks like.
+{
+  pthread_t *threads;
+  sigset_t signals, oldmask;
+  Message message = { NULL, 0, 0 };
+  sig_atomic_t seen = *report;
+  unsigned int k;
+  int rc;
+
+  ginterrupted = interrupted;
+  gstore = store;
+  gstarted = get_time();
+  glistener = open_listener(path);
+  if (glistener < 0)
+  {
+    report_error(path);
+    return EXIT_FAILURE;
+  }
+  signal(SIGPIPE, SIG_IGN); // a client that hangs up early is not our problem
+
+  // The signals are to be handled here, so that sigsuspend() below sees them.
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  sigaddset(&signals, SIGUSR1);
+  pthread_sigmask(SIG_BLOCK, &signals, &oldmask);
+  gclients = alloc(config.jobs * sizeof(int));
+  threads = alloc(config.jobs * sizeof(pthread_t));
+  for (k = 0; k < config.jobs; k++)
+  {
+    gclients[k] = -1;
+    rc = pthread_create(threads + k, NULL, run_thread, (void*)(uintptr_t) k);
+    if (rc != 0)
+    {
+      errno = rc;
+      perror(PACKAGE_NAME);
+      abort();
+    }
+  }
+
+  while (!*interrupted)
+  {
+    sigsuspend(&oldmask);
+    if (*report != seen)
+    {
+      seen = *report;
+      message.size = 0;
+      put_counters(&message);
+      fwrite(message.data, 1, message.size, stderr);
+    }
+  }
+  pthread_sigmask(SIG_SETMASK, &oldmask, NULL);
+
+  // Wake up the threads waiting for connections, and those waiting for requests.
+  pthread_mutex_lock(&glock);
+  gclosing = true;
+  shutdown(glistener, SHUT_RDWR);
+  for (k = 0; k < config.jobs; k++)
+    if (gclients[k] >= 0)
+      shutdown(gclients[k], SHUT_RD);
+  pthread_mutex_unlock(&glock);
+  for (k = 0; k < config.jobs; k++)
+    pthread_join(threads[k], NULL);
+  close(glistener);
+  unlink(path);
+
+  free(threads);
+  free(gclients);
+  free(message.data);
+  return EXIT_SUCCESS;
+}
+
+#else
+
+int run_server(const char *path, nonogram_store *store, const volatile sig_atomic_t *interrupted, const volatile sig_atomic_t *report)
+{
+  (void)path;
+  (void)store;
+  (void)interrupted;
+  (void)report;
+  fprintf(stderr, "%s: --serve is not supported on this system\n", PACKAGE_NAME);
+  return EXIT_FAILURE;
+}
+
+#endif
+
+/* vim:set ts=2 sts=2 sw=2 et: */
@@ -0,0 +1,2041 @@
+/* Copyright © 2003-2026 Jakub Wilk <jwilk@jwilk.net>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "autoconf.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef HAVE_MALLOC_TRIM
+#include <malloc.h>
+#endif
+
+#include "cache.h"
+#include "line.h"
+#include "memory.h"
+#include "nogood.h"
+#include "nonogram.h"
+#include "queue.h"
+#include "solver.h"
+#include "store.h"
+#include "timer.h"
+
+static inline bit span_cell(const uint64_t *filled, const uint64_t *empty, unsigned int t)
+// Get the t-th cell of a line from a pair of bit spans.
+{
+  if (span_test(filled, t))
+    return X;
+  return span_test(empty, t) ? O : Q;
+}
+
+static inline bit get_cell(const Picture *mpicture, unsigned int i, unsigned int j)
+{
+  size_t w = (size_t)i * mpicture->puzzle->rowwords;
+  return span_cell(mpicture->filled + w, mpicture->empty + w, j);
+}
+
+static inline void put_plane(Picture *mpicture, unsigned int i, unsigned int j, bit value)
+// Set the cell in both the row and the column bitplanes.
+{
+  const Puzzle *puzzle = mpicture->puzzle;
+  uint64_t mask = UINT64_C(1) << (j % WORD_BITS);
+  uint64_t cmask = UINT64_C(1) << (i % WORD_BITS);
+  size_t w = (size_t)i * puzzle->rowwords + j / WORD_BITS;
+  size_t cw = (size_t)j * puzzle->colwords + i / WORD_BITS;
+  if (value == X)
+  {
+    mpicture->filled[w] |= mask;
+    mpicture->cfilled[cw] |= cmask;
+  }
+  else
+  {
+    mpicture->empty[w] |= mask;
+    mpicture->cempty[cw] |= cmask;
+  }
+}
+
+static inline void set_cell(Picture *mpicture, unsigned int i, unsigned int j, bit value)
+// Set the so far unknown cell at row i, column j,
+// and record it in the trail.
+{
+  const Puzzle *puzzle = mpicture->puzzle;
+  unsigned int n = i * puzzle->xsize + j;
+
+  assert(get_cell(mpicture, i, j) == Q);
+  put_plane(mpicture, i, j, value);
+  mpicture->counter--;
+  mpicture->linecounter[i]--;
+  mpicture->linecounter[puzzle->ysize + j]--;
+  mpicture->position[n] = mpicture->trailsize;
+  mpicture->trail[mpicture->trailsize++] = n;
+}
+
+static inline int literal_value(const Picture *mpicture, Literal literal)
+// Return 1 if the literal holds, -1 if its cell has the other value,
+// or 0 if the cell is unknown.
+{
+  unsigned int n = literal / 2, xsize = mpicture->puzzle->xsize;
+  bit value = get_cell(mpicture, n / xsize, n % xsize);
+
+  if (value == Q)
+    return 0;
+  return (value == X) == (literal & 1) ? 1 : -1;
+}
+
+static void push_reason(Worker *worker, unsigned int start, unsigned int line, uint32_t nogood)
+// Record why the cells in the trail from start on were set, while searching.
+{
+  Reason *reason;
+
+  if (worker->reasons == NULL)
+    return;
+  if (worker->nreasons == worker->reasonscap)
+  {
+    worker->reasonscap *= 2;
+    worker->reasons = reallocate(worker->reasons, worker->reasonscap * sizeof (Reason));
+  }
+  reason = worker->reasons + worker->nreasons++;
+  reason->start = start;
+  reason->line = line;
+  reason->nogood = nogood;
+}
+
+static void save_bounds(Picture *mpicture, unsigned int line)
+// Record the bounds of the line in the trail,
+// unless they were already recorded since the last decision.
+{
+  BoundsSave *save;
+
+  if (mpicture->boundsstamp[line] == mpicture->serial)
+    return;
+  mpicture->boundsstamp[line] = mpicture->serial;
+  if (mpicture->boundstrailsize == mpicture->boundstrailcap)
+  {
+    mpicture->boundstrailcap *= 2;
+    mpicture->boundstrail = reallocate(mpicture->boundstrail, mpicture->boundstrailcap * sizeof(BoundsSave));
+  }
+  save = mpicture->boundstrail + mpicture->boundstrailsize++;
+  save->line = line;
+  save->bounds = mpicture->bounds[line];
+}
+
+static void undo(Picture *mpicture, unsigned int trailsize, unsigned int boundstrailsize)
+// Unset cells and restore line bounds, newest first,
+// until the trails are back to the given sizes.
+{
+  const Puzzle *puzzle = mpicture->puzzle;
+  unsigned int n, i, j;
+  uint64_t mask, cmask;
+  size_t w, cw;
+  BoundsSave *save;
+
+  while (mpicture->trailsize > trailsize)
+  {
+    n = mpicture->trail[--mpicture->trailsize];
+    i = n / puzzle->xsize;
+    j = n % puzzle->xsize;
+    mask = UINT64_C(1) << (j % WORD_BITS);
+    w = (size_t)i * puzzle->rowwords + j / WORD_BITS;
+    mpicture->filled[w] &= ~mask;
+    mpicture->empty[w] &= ~mask;
+    cmask = UINT64_C(1) << (i % WORD_BITS);
+    cw = (size_t)j * puzzle->colwords + i / WORD_BITS;
+    mpicture->cfilled[cw] &= ~cmask;
+    mpicture->cempty[cw] &= ~cmask;
+    mpicture->counter++;
+    mpicture->linecounter[i]++;
+    mpicture->linecounter[puzzle->ysize + j]++;
+  }
+  while (mpicture->boundstrailsize > boundstrailsize)
+  {
+    save = mpicture->boundstrail + --mpicture->boundstrailsize;
+    mpicture->bounds[save->line] = save->bounds;
+  }
+}
+
+static void undo_search(Worker *worker, unsigned int trailsize, unsigned int boundstrailsize)
+// Like undo(), but also forget why the cells were set.
+{
+  undo(worker->picture, trailsize, boundstrailsize);
+  while (worker->nreasons > 0 && worker->reasons[worker->nreasons - 1].start >= trailsize)
+    worker->nreasons--;
+  if (worker->nogoodhead > trailsize)
+    worker->nogoodhead = trailsize;
+}
+
+static void update_bounds(LineBounds *bounds, uint64_t *filled, uint64_t *empty, unsigned int size, const Clue *borderitem, unsigned int count)
+// Extend the solved head and tail of the line as far as the known cells allow.
+// Blocks are pinned only if their lengths agree with the clue;
+// anything else is left for the line solver to reject.
+{
+  unsigned int t, run;
+
+  run = 0;
+  for (t = bounds->head; t + bounds->tail < size; t++)
+    if (span_test(filled, t))
+      run++;
+    else if (span_test(empty, t))
+    {
+      if (run > 0)
+      {
+        if (bounds->headblocks + bounds->tailblocks >= count || borderitem[bounds->headblocks] != run)
+          break;
+        bounds->headblocks++;
+        run = 0;
+      }
+      bounds->head = t + 1;
+    }
+    else
+      break;
+
+  run = 0;
+  for (t = size - bounds->tail; t-- > bounds->head; )
+    if (span_test(filled, t))
+      run++;
+    else if (span_test(empty, t))
+    {
+      if (run > 0)
+      {
+        if (bounds->headblocks + bounds->tailblocks >= count || borderitem[count - 1 - bounds->tailblocks] != run)
+          break;
+        bounds->tailblocks++;
+        run = 0;
+      }
+      bounds->tail = size - t;
+    }
+    else
+      break;
+}
+
+static bool touch_line(Worker *worker, unsigned int line, uint64_t *filled, uint64_t *empty, unsigned int size, const Clue *borderitem,
+  uint64_t *rfilled, uint64_t *rempty)
+// Solve the line, except for its head and tail that are already solved.
+{
+  int rc;
+  unsigned int count = worker->puzzle->blockcount[line];
+  Picture *mpicture = worker->picture;
+  LineBounds *bounds = mpicture->bounds + line;
+
+  worker->linesolves++;
+  if (worker->linecache != NULL)
+  {
+    rc = lookup_line_cache(worker->linecache, line, filled, empty, span_words(size), rfilled, rempty);
+    if (rc >= 0)
+      return rc;
+  }
+  worker->fingercounter++;
+  save_bounds(mpicture, line);
+  update_bounds(bounds, filled, empty, size, borderitem, count);
+  rc = solve_line(worker->linesolver, filled, empty,
+    bounds->head, size - bounds->head - bounds->tail,
+    borderitem + bounds->headblocks, count - bounds->headblocks - bounds->tailblocks,
+    rfilled, rempty);
+  if (worker->linecache != NULL)
+    store_line_cache(worker->linecache, line, filled, empty, span_words(size), rfilled, rempty, rc);
+  return rc;
+}
+
+static void load_line(Worker *worker, unsigned int line, bool vert, uint64_t **filled, uint64_t **empty)
+// Get the known cells of the line (a row or a column) as bit spans.
+{
+  const Puzzle *puzzle = worker->puzzle;
+  Picture *mpicture = worker->picture;
+
+  if (vert)
+  {
+    *filled = mpicture->cfilled + (size_t)line * puzzle->colwords;
+    *empty = mpicture->cempty + (size_t)line * puzzle->colwords;
+  }
+  else
+  {
+    *filled = mpicture->filled + (size_t)line * puzzle->rowwords;
+    *empty = mpicture->empty + (size_t)line * puzzle->rowwords;
+  }
+}
+
+static bool finger_line(Worker *worker)
+// Return false if the line turned out to be contradictory.
+{
+  const Puzzle *puzzle = worker->puzzle;
+  Picture *mpicture = worker->picture;
+  Queue *queue = worker->queue;
+  uint64_t *filled, *empty, *rfilled, *rempty;
+  uint64_t fresh;
+  unsigned int i, j, k, w, lw, nw, size, oline, line, start = mpicture->trailsize;
+  int factor;
+  bool vert, ok;
+
+  worker->fingercounter++;
+  line = oline = get_from_queue(queue);
+  if (line < puzzle->ysize)
+    size = puzzle->xsize, vert = false;
+  else
+    size = puzzle->ysize, line -= puzzle->ysize, vert = true;
+
+  j = mpicture->linecounter[oline];
+  if (j == 0 || j == size)
+    return true;
+
+  lw = span_words(puzzle->xysize);
+  nw = span_words(size);
+  rfilled = worker->testfield;
+  rempty = rfilled + lw;
+  load_line(worker, line, vert, &filled, &empty);
+
+  ok = touch_line(worker, oline, filled, empty, size, line_clues(puzzle, oline), rfilled, rempty);
+  if (!ok)
+  {
+    // No placement at all. Empty the remaining cells,
+    // so that check_consistency() can spot the contradiction.
+    worker->conflictline = oline;
+    worker->conflictstart = start;
+    memset(rfilled, 0, nw * sizeof (uint64_t));
+    memset(rempty, 0xFF, nw * sizeof (uint64_t));
+  }
+
+  j = vert ? 0 : puzzle->ysize;
+  for (w = 0; w < nw; w++)
+  {
+    fresh = (rfilled[w] | rempty[w]) & ~(filled[w] | empty[w]);
+    while (fresh != 0)
+    {
+      k = __builtin_ctzll(fresh);
+      fresh &= fresh - 1;
+      i = w * WORD_BITS + k;
+      if (i >= size)
+        break;
+      worker->cells++;
+      if (vert)
+        set_cell(mpicture, i, line, ((rfilled[w] >> k) & 1) ? X : O);
+      else
+        set_cell(mpicture, line, i, ((rfilled[w] >> k) & 1) ? X : O);
+      factor = MAX_FACTOR * mpicture->linecounter[j + i] / size + puzzle->evilcounter[j + i];
+      put_into_queue(queue, j + i, factor);
+    }
+  }
+  if (mpicture->trailsize > start)
+    push_reason(worker, start, oline, NO_NOGOOD);
+  return ok;
+}
+
+static bool check_line(const Puzzle *puzzle, unsigned int line, const uint64_t *filled, const uint64_t *empty)
+// Check the line (a row or, from ysize on, a column), given as bit spans,
+// against its clue. Lines that are not complete yet pass.
+{
+  bool vert = line >= puzzle->ysize;
+  unsigned int j, rv = 0, size = vert ? puzzle->ysize : puzzle->xsize;
+  const char *name = vert ? "column" : "row";
+  const Clue *border = line_clues(puzzle, line);
+
+  if (vert)
+    line -= puzzle->ysize;
+  for (j = 0; j < size; j++)
+  switch (span_cell(filled, empty, j))
+  {
+  case Q:
+    return true;
+  case X:
+    rv++;
+    break;
+  case O:
+    if (rv == 0)
+      break;
+    if (*border != rv)
+    {
+      if (ENABLE_DEBUG)
+        fprintf(stderr, "Inconsistency at %s #%u[%u]! (%u, expected %u)\n", name, line, j, rv, *border);
+      return false;
+    }
+    rv = 0; border++;
+    break;
+  default:
+    ;
+  }
+  if (rv > 0 && *border == rv)
+    border++, rv = 0;
+  if (*border != rv)
+  {
+    if (ENABLE_DEBUG)
+      fprintf(stderr, "Inconsistency at the end of %s #%u! (%u, expected %u)\n", name, line, rv, *border);
+    return false;
+  }
+  return true;
+}
+
+static unsigned int find_bad_line(const Puzzle *puzzle, const uint64_t *filled, const uint64_t *empty, const uint64_t *cfilled, const uint64_t *cempty)
+// Find a complete row or column of the picture, given as row and column
+// bitplanes, that doesn't match its clue.
+// Return NO_LINE if there is none.
+{
+  unsigned int i;
+  size_t w;
+
+  for (i = 0; i < puzzle->ysize; i++)
+  {
+    w = (size_t)i * puzzle->rowwords;
+    if (!check_line(puzzle, i, filled + w, empty + w))
+      return i;
+  }
+  for (i = 0; i < puzzle->xsize; i++)
+  {
+    w = (size_t)i * puzzle->colwords;
+    if (!check_line(puzzle, puzzle->ysize + i, cfilled + w, cempty + w))
+      return puzzle->ysize + i;
+  }
+  return NO_LINE;
+}
+
+bool check_consistency(const Puzzle *puzzle, const uint64_t *filled, const uint64_t *empty, const uint64_t *cfilled, const uint64_t *cempty)
+// Check the picture, given as row and column bitplanes, against the clues.
+// Rows and columns that are not complete yet are skipped.
+{
+  return find_bad_line(puzzle, filled, empty, cfilled, cempty) == NO_LINE;
+}
+
+static inline void *alloc_testfield(unsigned int maxsize)
+{
+  return alloc(2 * span_words(maxsize) * sizeof(uint64_t));
+}
+
+static Picture *alloc_picture(const Puzzle *puzzle)
+{
+  unsigned int i;
+  Picture *tmp = alloc(sizeof(Picture));
+  tmp->puzzle = puzzle;
+  tmp->linecounter = alloc(sizeof(unsigned int) * puzzle->xpysize);
+  tmp->bounds = alloc(sizeof(LineBounds) * puzzle->xpysize);
+  tmp->filled = alloc(sizeof(uint64_t) * puzzle->ysize * puzzle->rowwords);
+  tmp->empty = alloc(sizeof(uint64_t) * puzzle->ysize * puzzle->rowwords);
+  tmp->cfilled = alloc(sizeof(uint64_t) * puzzle->xsize * puzzle->colwords);
+  tmp->cempty = alloc(sizeof(uint64_t) * puzzle->xsize * puzzle->colwords);
+  tmp->trail = alloc(sizeof(unsigned int) * puzzle->vsize);
+  tmp->position = alloc(sizeof(unsigned int) * puzzle->vsize);
+  tmp->boundstrailcap = puzzle->xpysize;
+  tmp->boundstrail = alloc(sizeof(BoundsSave) * tmp->boundstrailcap);
+  tmp->boundsstamp = alloc(sizeof(uint64_t) * puzzle->xpysize);
+  for (i = 0; i < puzzle->ysize; i++)
+    tmp->linecounter[i] = puzzle->xsize;
+  for (i = 0; i < puzzle->xsize; i++)
+    tmp->linecounter[puzzle->ysize + i] = puzzle->ysize;
+  tmp->counter = puzzle->vsize;
+  return tmp;
+}
+
+static void copy_planes(Picture *dst, const Picture *src)
+{
+  const Puzzle *puzzle = src->puzzle;
+  memcpy(dst->filled, src->filled, puzzle->ysize * puzzle->rowwords * sizeof(uint64_t));
+  memcpy(dst->empty, src->empty, puzzle->ysize * puzzle->rowwords * sizeof(uint64_t));
+  memcpy(dst->cfilled, src->cfilled, puzzle->xsize * puzzle->colwords * sizeof(uint64_t));
+  memcpy(dst->cempty, src->cempty, puzzle->xsize * puzzle->colwords * sizeof(uint64_t));
+}
+
+static Picture *clone_picture(Picture *picture)
+// Copy the current state of the picture, but not its trails.
+{
+  const Puzzle *puzzle = picture->puzzle;
+  Picture *tmp = alloc_picture(puzzle);
+  tmp->counter = picture->counter;
+  memcpy(tmp->linecounter, picture->linecounter, puzzle->xpysize * sizeof(unsigned int));
+  memcpy(tmp->bounds, picture->bounds, puzzle->xpysize * sizeof(LineBounds));
+  copy_planes(tmp, picture);
+  return tmp;
+}
+
+static inline void free_picture(Picture *picture)
+{
+  free(picture->linecounter);
+  free(picture->bounds);
+  free(picture->filled);
+  free(picture->empty);
+  free(picture->cfilled);
+  free(picture->cempty);
+  free(picture->trail);
+  free(picture->position);
+  free(picture->boundstrail);
+  free(picture->boundsstamp);
+  free(picture);
+}
+
+bool check_cells(const Puzzle *puzzle, const bit *cells)
+// Check the complete picture, given cell by cell, against the clues.
+{
+  Picture *tmp = alloc_picture(puzzle);
+  unsigned int i, j;
+  bool ok = true;
+
+  for (i = 0; i < puzzle->ysize && ok; i++)
+  for (j = 0; j < puzzle->xsize && ok; j++)
+  switch (*cells++)
+  {
+  case X:
+  case O:
+    put_plane(tmp, i, j, cells[-1]);
+    break;
+  default:
+    ok = false;
+  }
+  ok = ok && check_consistency(puzzle, tmp->filled, tmp->empty, tmp->cfilled, tmp->cempty);
+  free_picture(tmp);
+  return ok;
+}
+
+static Worker *alloc_worker(unsigned int id, Solver *solver)
+{
+  Worker *tmp = alloc(sizeof(Worker));
+  tmp->id = id;
+  tmp->solver = solver;
+  pthread_mutex_init(&tmp->lock, NULL);
+  return tmp;
+}
+
+static void start_learning(Worker *worker, size_t budget)
+// Get the worker ready to learn nogoods while searching,
+// using about budget bytes for them.
+{
+  const Puzzle *puzzle = worker->puzzle;
+
+  worker->nogoods = alloc_nogood_base(puzzle->vsize, budget);
+  worker->reasonscap = 1024;
+  worker->reasons = alloc(worker->reasonscap * sizeof (Reason));
+  worker->nreasons = 0;
+  worker->seen = alloc(puzzle->vsize);
+  worker->buffer = alloc(puzzle->vsize * sizeof (unsigned int));
+  worker->literals = alloc(puzzle->vsize * sizeof (Literal));
+}
+
+static void start_search(Worker *worker)
+// Make room for the guesses. Pictures that line solving and probing finish
+// never need it, so it's put off until now.
+{
+  const Puzzle *puzzle = worker->puzzle;
+
+  if (worker->maxcells < puzzle->vsize)
+  {
+    free(worker->rowp);
+    free(worker->stack);
+    worker->rowp = alloc(puzzle->vsize * sizeof(float));
+    worker->stack = alloc(puzzle->vsize * sizeof(Decision));
+    worker->maxcells = puzzle->vsize;
+  }
+}
+
+static void stop_learning(Worker *worker)
+{
+  if (worker->nogoods == NULL)
+    return;
+  free_nogood_base(worker->nogoods);
+  free(worker->reasons);
+  free(worker->seen);
+  free(worker->buffer);
+  free(worker->literals);
+  worker->nogoods = NULL;
+  worker->reasons = NULL;
+  worker->seen = NULL;
+  worker->buffer = NULL;
+  worker->literals = NULL;
+}
+
+static void free_worker(Worker *worker)
+{
+  stop_learning(worker);
+  if (worker->picture != NULL)
+    free_picture(worker->picture);
+  if (worker->queue != NULL)
+    free_queue(worker->queue);
+  if (worker->linesolver != NULL)
+    free_line_solver(worker->linesolver);
+  if (worker->linecache != NULL)
+    free_line_cache(worker->linecache);
+  free(worker->testfield);
+  free(worker->marginals);
+  free(worker->rowp);
+  free(worker->stack);
+  pthread_mutex_destroy(&worker->lock);
+  free(worker);
+}
+
+static void setup_worker(Worker *worker, const Puzzle *puzzle, size_t cachesize)
+// Get the worker ready for the puzzle.
+// Buffers left from the previous puzzle are reused if they're large enough.
+{
+  unsigned int maxblocks = puzzle->lmax > puzzle->tmax ? puzzle->lmax : puzzle->tmax;
+
+  worker->puzzle = puzzle;
+  if (worker->picture != NULL)
+    free_picture(worker->picture);
+  worker->picture = NULL;
+  if (worker->queue == NULL || worker->queue->capacity < puzzle->xpysize)
+  {
+    if (worker->queue != NULL)
+      free_queue(worker->queue);
+    worker->queue = alloc_queue(puzzle->xpysize);
+  }
+  if (worker->linesolver == NULL || worker->linesolver->maxsize < puzzle->xysize || worker->linesolver->maxblocks < maxblocks)
+  {
+    if (worker->linesolver != NULL)
+      free_line_solver(worker->linesolver);
+    worker->linesolver = alloc_line_solver(puzzle->xysize, maxblocks);
+  }
+  if (worker->linecache == NULL || worker->linecache->nwords < span_words(puzzle->xysize))
+  {
+    if (worker->linecache != NULL)
+      free_line_cache(worker->linecache);
+    worker->linecache = alloc_line_cache(puzzle->xysize, cachesize);
+  }
+  else
+    clear_line_cache(worker->linecache);
+  if (worker->maxsize < puzzle->xysize)
+  {
+    free(worker->testfield);
+    free(worker->marginals);
+    worker->testfield = alloc_testfield(puzzle->xysize);
+    worker->marginals = alloc(puzzle->xysize * sizeof(double));
+    worker->maxsize = puzzle->xysize;
+  }
+  worker->queue->pushes = worker->queue->pops = 0;
+  worker->fingercounter = 0;
+  worker->linesolves = worker->cells = 0;
+  worker->probes = 0;
+  worker->nodes = worker->failures = 0;
+  worker->learned = worker->backjumps = 0;
+  worker->maxdepth = 0;
+  worker->depth = 0;
+  atomic_store(&worker->shownfingercounter, 0);
+  atomic_store(&worker->shownnodes, 0);
+  atomic_store(&worker->showndepth, 0);
+  atomic_store(&worker->shownmaxdepth, 0);
+  atomic_store(&worker->shownunknown, UINT_MAX); // there's no picture yet
+}
+
+static inline void preset_cell(Picture *mpicture, unsigned int i, unsigned int j, bit value)
+// Set the cell at row i, column j, unless it is already known.
+// Unlike set_cell(), don't record it in the trail.
+{
+  const Puzzle *puzzle = mpicture->puzzle;
+
+  if (get_cell(mpicture, i, j) != Q)
+    return;
+  put_plane(mpicture, i, j, value);
+  mpicture->counter--;
+  mpicture->linecounter[i]--;
+  mpicture->linecounter[puzzle->ysize + j]--;
+}
+
+static void preliminary_shake(Picture *mpicture)
+{
+  const Puzzle *puzzle = mpicture->puzzle;
+  unsigned int i, j, k;
+  unsigned int R, ML;
+  const Clue *band;
+
+  for (i = 0; i < puzzle->ysize; i++)
+  {
+    band = line_clues(puzzle, i);
+    R = *band++;
+    ML = R;
+    while (*band > 0)
+      ML += *band++ + 1;
+
+    band = line_clues(puzzle, i);
+    if (*band == 0)
+      for (j = 0; j < puzzle->xsize; j++)
+        preset_cell(mpicture, i, j, O);
+    while (*band > 0)
+    {
+      k = puzzle->xsize - ML;
+      for ( ; k < R; k++)
+        preset_cell(mpicture, i, k, X);
+      ML -= *band; ML--;
+      R++; R += *++band;
+    }
+  }
+
+  for (i = 0; i < puzzle->xsize; i++)
+  {
+    band = line_clues(puzzle, puzzle->ysize + i);
+    R = *band++;
+    ML = R;
+    while (*band > 0)
+      ML += *band++ + 1;
+
+    band = line_clues(puzzle, puzzle->ysize + i);
+    if (*band == 0)
+      for (j = 0; j < puzzle->ysize; j++)
+        preset_cell(mpicture, j, i, O);
+    while (*band > 0)
+    {
+      k = puzzle->ysize - ML;
+      for ( ; k < R; k++)
+        preset_cell(mpicture, k, i, X);
+      ML -= *band; ML--;
+      R++; R += *++band;
+    }
+  }
+}
+
+static size_t get_memory_usage(void)
+// Return how much memory the process is using right now (its resident set
+// size), in bytes, or 0 if that's unknown.
+{
+  FILE *file;
+  unsigned long size, resident;
+  long pagesize = sysconf(_SC_PAGESIZE);
+  bool ok;
+
+  file = fopen("/proc/self/statm", "r");
+  if (file == NULL)
+    return 0;
+  ok = fscanf(file, "%lu %lu", &size, &resident) == 2;
+  fclose(file);
+  return ok && pagesize > 0 ? (size_t) resident * pagesize : 0;
+}
+
+static bool over_memory(const Solver *solver)
+// The limit is on what the process uses now, not on its peak, so that one big
+// puzzle doesn't make all the ones after it give up, too. Memory that was
+// freed, but not given back to the system yet, doesn't count.
+{
+  if (get_memory_usage() <= solver->maxmemory)
+    return false;
+#ifdef HAVE_MALLOC_TRIM
+  malloc_trim(0);
+  return get_memory_usage() > solver->maxmemory;
+#else
+  return true;
+#endif
+}
+
+static void stop(Solver *solver)
+{
+  atomic_store(&solver->stopped, true);
+  atomic_store(&solver->done, true);
+}
+
+static void publish_progress(Worker *worker)
+// Copy the counters for report_progress(), which may run in another thread.
+{
+  const memory_order relaxed = memory_order_relaxed;
+
+  atomic_store_explicit(&worker->shownfingercounter, worker->fingercounter, relaxed);
+  atomic_store_explicit(&worker->shownnodes, worker->nodes, relaxed);
+  atomic_store_explicit(&worker->showndepth, worker->depth, relaxed);
+  atomic_store_explicit(&worker->shownmaxdepth, worker->maxdepth, relaxed);
+  atomic_store_explicit(&worker->shownunknown, worker->picture->counter, relaxed);
+}
+
+static void report_progress(Solver *solver, double now, bool requested)
+// Sum up what the workers published last, and pass it to the callback.
+// If another worker is reporting already, or has just answered the request,
+// do nothing.
+{
+  const memory_order relaxed = memory_order_relaxed;
+  nonogram_progress progress;
+  Worker *worker;
+  unsigned int k, n;
+  sig_atomic_t request;
+  double dt;
+
+  if (atomic_flag_test_and_set(&solver->reporting))
+    return;
+  if (requested)
+  {
+    request = *solver->progressflag;
+    if (request == atomic_load(&solver->progressseen))
+    {
+      atomic_flag_clear(&solver->reporting);
+      return;
+    }
+    atomic_store(&solver->progressseen, request);
+  }
+  memset(&progress, 0, sizeof progress);
+  progress.phase = solver->phase;
+  progress.time = now - solver->started;
+  progress.unknown = UINT_MAX;
+  for (k = 0; k < solver->nworkers; k++)
+  {
+    worker = solver->workers[k];
+    progress.fingercounter += atomic_load_explicit(&worker->shownfingercounter, relaxed);
+    progress.nodes += atomic_load_explicit(&worker->shownnodes, relaxed);
+    n = atomic_load_explicit(&worker->showndepth, relaxed);
+    if (n > progress.depth)
+      progress.depth = n;
+    n = atomic_load_explicit(&worker->shownmaxdepth, relaxed);
+    if (n > progress.maxdepth)
+      progress.maxdepth = n;
+    n = atomic_load_explicit(&worker->shownunknown, relaxed);
+    if (n < progress.unknown)
+      progress.unknown = n;
+  }
+  dt = now - solver->lastreport;
+  if (dt > 0)
+  {
+    progress.lines_per_second = (progress.fingercounter - solver->lastfingercounter) / dt;
+    progress.nodes_per_second = (progress.nodes - solver->lastnodes) / dt;
+  }
+  solver->lastreport = now;
+  solver->lastfingercounter = progress.fingercounter;
+  solver->lastnodes = progress.nodes;
+  solver->progresscallback(&progress, solver->progressdata);
+  atomic_flag_clear(&solver->reporting);
+}
+
+static bool should_stop(Worker *worker)
+// Check whether the solver is to give up: because it was interrupted, or
+// because it ran out of time or memory. Also report progress, if asked to.
+// The clock and the memory usage are only looked at every so often, as they
+// cost a system call.
+{
+  Solver *solver = worker->solver;
+  double now;
+
+  if (atomic_load_explicit(&solver->stopped, memory_order_relaxed))
+    return true;
+  if (solver->interrupt != NULL && *solver->interrupt)
+  {
+    stop(solver);
+    return true;
+  }
+  if (solver->progressflag != NULL && *solver->progressflag != atomic_load_explicit(&solver->progressseen, memory_order_relaxed)
+    && solver->progresscallback != NULL)
+  {
+    publish_progress(worker);
+    report_progress(solver, get_time(), true);
+  }
+  if (++worker->ticks % 64 != 0)
+    return false;
+  now = solver->deadline > 0 || solver->progressinterval > 0 ? get_time() : 0;
+  if (solver->deadline > 0 && now > solver->deadline)
+    stop(solver);
+  else if (solver->maxmemory > 0 && worker->ticks % 1024 == 0 && over_memory(solver))
+    stop(solver);
+  if (solver->progresscallback != NULL)
+  {
+    publish_progress(worker);
+    // Only the first worker reports on schedule, so that nextreport is its own.
+    if (worker->id == 0 && solver->progressinterval > 0 && now >= solver->nextreport)
+    {
+      solver->nextreport = now + solver->progressinterval;
+      report_progress(solver, now, false);
+    }
+  }
+  return atomic_load(&solver->stopped);
+}
+
+static void queue_cell_lines(Worker *worker, unsigned int i, unsigned int j)
+// Put the row and the column of the cell into the queue.
+{
+  const Puzzle *puzzle = worker->puzzle;
+  Picture *mpicture = worker->picture;
+  Queue *queue = worker->queue;
+  unsigned int line = puzzle->ysize + j;
+
+  put_into_queue(queue, i, MAX_FACTOR * mpicture->linecounter[i] / puzzle->xsize + puzzle->evilcounter[i]);
+  put_into_queue(queue, line, MAX_FACTOR * mpicture->linecounter[line] / puzzle->ysize + puzzle->evilcounter[line]);
+}
+
+static bool apply_nogoods(Worker *worker)
+// Check the cells set since the last time against the nogoods watching them.
+// Once all the literals of a nogood but one hold, the cell of that one gets
+// the other value, and its lines are queued.
+// Return false if all the literals of a nogood hold.
+{
+  const Puzzle *puzzle = worker->puzzle;
+  Picture *mpicture = worker->picture;
+  NogoodBase *base = worker->nogoods;
+  Literal *lits, literal;
+  uint32_t tmp, *link, *next, *cursor;
+  uint32_t ref;
+  unsigned int n, k, m, cell;
+
+  while (worker->nogoodhead < mpicture->trailsize)
+  {
+    cell = mpicture->trail[worker->nogoodhead++];
+    literal = make_literal(cell, get_cell(mpicture, cell / puzzle->xsize, cell % puzzle->xsize) == X);
+    for (link = base->watches + literal; (ref = *link) != NO_NOGOOD; )
+    {
+      // Make the literal that now holds the second one.
+      lits = nogood_literals(base, ref);
+      next = nogood_next(base, ref);
+      if (lits[0] == literal)
+      {
+        lits[0] = lits[1];
+        lits[1] = literal;
+        tmp = next[0];
+        next[0] = next[1];
+        next[1] = tmp;
+      }
+      if (literal_value(mpicture, lits[0]) < 0)
+      {
+        link = next + 1;
+        continue;
+      }
+      // Watch another literal that doesn't hold, if there is one.
+      // Go round from where the previous search ended: the literals just
+      // before are likely to hold still.
+      n = nogood_size(base, ref);
+      cursor = nogood_cursor(base, ref);
+      for (k = *cursor, m = n - 2; m > 0 && literal_value(mpicture, lits[k]) > 0; m--)
+        if (++k == n)
+          k = 2;
+      if (m > 0)
+      {
+        *cursor = k;
+        lits[1] = lits[k];
+        lits[k] = literal;
+        *link = next[1];
+        next[1] = base->watches[lits[1]];
+        base->watches[lits[1]] = ref;
+        continue;
+      }
+      if (literal_value(mpicture, lits[0]) > 0)
+      {
+        worker->conflictline = NO_LINE;
+        worker->conflictnogood = ref;
+        return false;
+      }
+      n = lits[0] / 2;
+      push_reason(worker, mpicture->trailsize, NO_LINE, ref);
+      set_cell(mpicture, n / puzzle->xsize, n % puzzle->xsize, (lits[0] & 1) ? O : X);
+      queue_cell_lines(worker, n / puzzle->xsize, n % puzzle->xsize);
+      link = next + 1;
+    }
+  }
+  return true;
+}
+
+static inline bool nogoods_pending(const Worker *worker)
+{
+  return worker->nogoods != NULL && worker->nogoodhead < worker->picture->trailsize;
+}
+
+static bool solve_queue(Worker *worker)
+// Solve the lines in the queue, and whatever lines that affected,
+// until nothing more can be deduced, or the solver gives up.
+// While searching, check the cells set against the nogoods, too.
+// Return false if a contradiction was found.
+{
+  bool ok = true;
+
+  while (ok && (nogoods_pending(worker) || !is_queue_empty(worker->queue)) && !should_stop(worker))
+    ok = nogoods_pending(worker) ? apply_nogoods(worker) : finger_line(worker);
+  clear_queue(worker->queue);
+  return ok;
+}
+
+static bool shake(Worker *worker)
+// Solve lines until nothing more can be deduced, or the solver gives up.
+// Return false if a contradiction was found.
+{
+  const Puzzle *puzzle = worker->puzzle;
+  unsigned int i, j;
+  int factor;
+  Picture *mpicture = worker->picture;
+  Queue *queue = worker->queue;
+
+  assert(puzzle->ysize > 0);
+
+  for (i = 0; i < puzzle->ysize; i++)
+  {
+    factor = MAX_FACTOR * mpicture->linecounter[i] / puzzle->xsize + puzzle->evilcounter[i];
+    put_into_queue(queue, i, factor);
+  }
+
+  for (i = 0, j = puzzle->ysize; i < puzzle->xsize; i++, j++)
+  {
+    factor = MAX_FACTOR * mpicture->linecounter[j] / puzzle->ysize + puzzle->evilcounter[i];
+    put_into_queue(queue, j, factor);
+  }
+  return solve_queue(worker);
+}
+
+static bool propagate(Worker *worker, unsigned int i, unsigned int j)
+// Solve the row and the column of the cell that was just set,
+// and then whatever lines that affected.
+// Return false if a contradiction was found.
+{
+  queue_cell_lines(worker, i, j);
+  return solve_queue(worker);
+}
+
+static bool probe_cell(Worker *worker, unsigned int i, unsigned int j, bit value)
+// Set the cell tentatively, and see what follows.
+// Return false if a contradiction was found.
+{
+  Picture *mpicture = worker->picture;
+
+  worker->probes++;
+  mpicture->serial++;
+  set_cell(mpicture, i, j, value);
+  return propagate(worker, i, j) &&
+    (mpicture->counter > 0 || check_consistency(worker->puzzle, mpicture->filled, mpicture->empty, mpicture->cfilled, mpicture->cempty));
+}
+
+static bool probe(Solver *solver)
+// Try both values of every unknown cell in turn, solving lines after each.
+// If one value leads to a contradiction, the cell gets the other one.
+// Otherwise, cells that got the same value both ways are set to it.
+// Repeat until nothing changes, or the solver gives up.
+// Return false if the puzzle turned out to be inconsistent.
+{
+  const Puzzle *puzzle = solver->puzzle;
+  Worker *worker = solver->workers[0];
+  Picture *mpicture = solver->picture;
+  unsigned int *marks, *common; // cells set when trying X, tagged with the stamp; cells set both ways
+  unsigned int n, m, k, ncommon, stamp = 0;
+  unsigned int trailsize, boundstrailsize;
+  bool okx, oko, ok = true, changed = true;
+
+  marks = alloc(puzzle->vsize * sizeof(unsigned int));
+  common = alloc(puzzle->vsize * sizeof(unsigned int));
+  while (ok && changed && !atomic_load(&solver->stopped))
+  {
+    changed = false;
+    for (n = 0; n < puzzle->vsize && ok && !atomic_load(&solver->stopped); n++)
+    {
+      unsigned int i = n / puzzle->xsize, j = n % puzzle->xsize;
+      if (get_cell(mpicture, i, j) != Q)
+        continue;
+      if (++stamp > UINT_MAX / 2)
+      {
+        memset(marks, 0, puzzle->vsize * sizeof(unsigned int));
+        stamp = 1;
+      }
+      trailsize = mpicture->trailsize;
+      boundstrailsize = mpicture->boundstrailsize;
+      okx = probe_cell(worker, i, j, X);
+      for (k = trailsize; okx && k < mpicture->trailsize; k++)
+      {
+        m = mpicture->trail[k];
+        marks[m] = 2 * stamp + (get_cell(mpicture, m / puzzle->xsize, m % puzzle->xsize) == X);
+      }
+      undo(mpicture, trailsize, boundstrailsize);
+      oko = probe_cell(worker, i, j, O);
+      if (!okx)
+      {
+        // Keep the consequences of O, if there are no contradictions there either.
+        ok = oko;
+        changed = true;
+        continue;
+      }
+      ncommon = 0;
+      for (k = trailsize; oko && k < mpicture->trailsize; k++)
+      {
+        m = mpicture->trail[k];
+        if (marks[m] == 2 * stamp + (get_cell(mpicture, m / puzzle->xsize, m % puzzle->xsize) == X))
+          common[ncommon++] = m;
+      }
+      undo(mpicture, trailsize, boundstrailsize);
+      if (!oko)
+      {
+        ok = probe_cell(worker, i, j, X);
+        changed = true;
+        continue;
+      }
+      mpicture->serial++;
+      for (k = 0; k < ncommon && ok; k++)
+      {
+        m = common[k];
+        i = m / puzzle->xsize;
+        j = m % puzzle->xsize;
+        if (get_cell(mpicture, i, j) != Q)
+          continue;
+        set_cell(mpicture, i, j, (marks[m] & 1) ? X : O);
+        ok = propagate(worker, i, j);
+        changed = true;
+      }
+    }
+  }
+  free(marks);
+  free(common);
+  return ok;
+}
+
+static void choose_cell(Worker *worker, unsigned int *ri, unsigned int *rj, bit *rvalue)
+// Pick the unknown cell whose value is the most certain, and its likelier value.
+//
+// The probability that a cell is filled is estimated as the fraction of
+// placements filling it, as computed by count_line() for its row and its
+// column; whichever of the two is further from 1/2 wins. Ties are broken in
+// favour of cells in lines with fewer unknown cells, then in lines with
+// higher evilcounter.
+// Only the part of the picture being searched is considered.
+{
+  const Puzzle *puzzle = worker->puzzle;
+  const Solver *solver = worker->solver;
+  Picture *mpicture = worker->picture;
+  uint64_t *filled, *empty;
+  LineBounds *bounds;
+  unsigned int i, line, size, head, best_lc = 0, lc;
+  unsigned int best_evil = 0, evil;
+  double pr, pc, p, d, best_d = -1.0;
+  bool ok;
+
+  *ri = *rj = 0;
+  *rvalue = O;
+
+  for (line = 0; line < puzzle->xpysize; line++)
+  {
+    bool vert = line >= puzzle->ysize;
+    unsigned int l = vert ? line - puzzle->ysize : line;
+    size = vert ? puzzle->ysize : puzzle->xsize;
+    if (mpicture->linecounter[line] == 0 || solver->linecomponent[line] != solver->focus)
+      continue;
+    bounds = mpicture->bounds + line;
+    head = bounds->head;
+    load_line(worker, l, vert, &filled, &empty);
+    ok = count_line(worker->linesolver, filled, empty, head, size - head - bounds->tail,
+      line_clues(puzzle, line) + bounds->headblocks,
+      puzzle->blockcount[line] - bounds->headblocks - bounds->tailblocks, worker->marginals);
+    for (i = head; i < size - bounds->tail; i++)
+    {
+      unsigned int y = vert ? i : l, x = vert ? l : i;
+      if (get_cell(mpicture, y, x) != Q)
+        continue;
+      p = ok ? worker->marginals[i - head] : 0.5;
+      if (!vert)
+      {
+        worker->rowp[y * puzzle->xsize + x] = p;
+        continue;
+      }
+      pr = worker->rowp[y * puzzle->xsize + x];
+      pc = p;
+      p = fabs(pr - 0.5) > fabs(pc - 0.5) ? pr : pc;
+      d = fabs(p - 0.5);
+      lc = mpicture->linecounter[y] + mpicture->linecounter[line];
+      evil = puzzle->evilcounter[y] + puzzle->evilcounter[line];
+      if (d > best_d || (d == best_d && (lc < best_lc || (lc == best_lc && evil > best_evil))))
+      {
+        best_d = d;
+        best_lc = lc;
+        best_evil = evil;
+        *ri = y;
+        *rj = x;
+        *rvalue = p > 0.5 ? X : O;
+      }
+    }
+  }
+  assert(best_d >= 0.0);
+}
+
+static unsigned int cell_level(const Worker *worker, unsigned int cell)
+// Find how many guesses were in effect when the known cell was set:
+// 0 if it was known before the search.
+{
+  const Picture *mpicture = worker->picture;
+  unsigned int p = mpicture->position[cell], lo = 0, hi = worker->depth, mid;
+
+  if (p < worker->roottrailsize || p >= mpicture->trailsize || mpicture->trail[p] != cell)
+    return 0;
+  while (lo < hi)
+  {
+    mid = (lo + hi) / 2;
+    if (worker->stack[mid].trailsize <= p)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+static const Reason *find_reason(const Worker *worker, unsigned int position)
+// Find why the cell at the position in the trail was set.
+{
+  unsigned int lo = 0, hi = worker->nreasons, mid;
+
+  assert(hi > 0 && worker->reasons[0].start <= position);
+  while (hi - lo > 1)
+  {
+    mid = (lo + hi) / 2;
+    if (worker->reasons[mid].start <= position)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  return worker->reasons + lo;
+}
+
+static unsigned int line_cells(Worker *worker, unsigned int line, unsigned int start, unsigned int *cells)
+// Put in cells the cells of the line that were set while searching,
+// before the trail reached start. Return how many there are.
+{
+  const Puzzle *puzzle = worker->puzzle;
+  const Picture *mpicture = worker->picture;
+  uint64_t *filled, *empty, known;
+  bool vert = line >= puzzle->ysize;
+  unsigned int w, t, p, cell, n = 0;
+  unsigned int size = vert ? puzzle->ysize : puzzle->xsize;
+
+  if (vert)
+    line -= puzzle->ysize;
+  load_line(worker, line, vert, &filled, &empty);
+  for (w = 0; w < span_words(size); w++)
+  for (known = filled[w] | empty[w]; known != 0; known &= known - 1)
+  {
+    t = w * WORD_BITS + __builtin_ctzll(known);
+    if (t >= size)
+      break;
+    cell = vert ? t * puzzle->xsize + line : line * puzzle->xsize + t;
+    p = mpicture->position[cell];
+    if (p >= worker->roottrailsize && p < start && mpicture->trail[p] == cell)
+      cells[n++] = cell;
+  }
+  return n;
+}
+
+static unsigned int nogood_cells(const Worker *worker, uint32_t ref, unsigned int except, unsigned int *cells)
+// Put in cells the cells of the nogood, but the one given.
+// Return how many there are.
+{
+  const Literal *lits;
+  unsigned int k, size, n = 0;
+
+  if (ref == NO_NOGOOD)
+    return 0;
+  lits = nogood_literals(worker->nogoods, ref);
+  size = nogood_size(worker->nogoods, ref);
+  for (k = 0; k < size; k++)
+    if (lits[k] / 2 != except)
+      cells[n++] = lits[k] / 2;
+  return n;
+}
+
+static unsigned int reason_cells(Worker *worker, const Reason *reason, unsigned int cell, unsigned int *cells)
+// Put in cells the cells the cell was deduced from, for the reason given.
+// Return how many there are.
+{
+  if (reason->line != NO_LINE)
+    return line_cells(worker, reason->line, reason->start, cells);
+  return nogood_cells(worker, reason->nogood, cell, cells);
+}
+
+static unsigned int count_fixed(Worker *worker)
+// Count the guesses at the bottom of the stack whose alternatives were
+// already taken care of: by another worker, or by this one, before it took
+// over the rest from another worker. These must stay.
+{
+  unsigned int k;
+
+  pthread_mutex_lock(&worker->lock);
+  for (k = 0; k < worker->depth && worker->stack[k].flipped; k++)
+    ;
+  pthread_mutex_unlock(&worker->lock);
+  return k;
+}
+
+static uint32_t keep_nogood(Worker *worker, const Literal *literals, unsigned int n, bool permanent)
+// Add the nogood to those of the worker, making room first if needed.
+// Nogoods that cells in the trail were deduced from must stay.
+{
+  NogoodBase *base = worker->nogoods;
+  uint32_t *refs = NULL;
+  unsigned int k, nrefs = 0;
+
+  if (nogood_base_full(base, n))
+  {
+    if (worker->nreasons > 0)
+      refs = alloc(worker->nreasons * sizeof (uint32_t));
+    for (k = 0; k < worker->nreasons; k++)
+      if (worker->reasons[k].nogood != NO_NOGOOD)
+        refs[nrefs++] = worker->reasons[k].nogood;
+    reduce_nogoods(base, refs, nrefs);
+    for (k = 0, nrefs = 0; k < worker->nreasons; k++)
+      if (worker->reasons[k].nogood != NO_NOGOOD)
+        worker->reasons[k].nogood = refs[nrefs++];
+    free(refs);
+  }
+  return add_nogood(base, literals, n, permanent);
+}
+
+static bool learn(Worker *worker, bool solved, unsigned int *ri, unsigned int *rj, bit *rvalue, uint32_t *rnogood)
+// Work out which guesses led to the contradiction just met (or, if solved,
+// to the solution just found, which is not to be found again), and learn a
+// nogood that rules out what they led to. Go back to the latest guess the
+// nogood involves, and get from it the cell to set next, with the nogood as
+// its reason.
+//
+// A cell deduced from a line is taken to follow from all the cells of the
+// line that were known by then; a cell deduced from a nogood, from the other
+// cells of the nogood. Going back from the contradiction through these, the
+// nogood is made of the latest cell all the paths from the latest guess
+// involved go through, and of the cells set before that guess that they go
+// through. Cells known before the search are left out.
+//
+// Return false if the contradiction follows from the guesses that must stay
+// (see count_fixed()) alone: the worker has nothing left to explore then.
+{
+  const Puzzle *puzzle = worker->puzzle;
+  Picture *mpicture = worker->picture;
+  unsigned char *seen = worker->seen;
+  unsigned int *cells = worker->buffer;
+  Literal *literals = worker->literals, tmp;
+  const Reason *reason;
+  unsigned int j, k, m, n, p, cell, level, top, nliterals = 1, counter = 0, conflictlevel = 0, backlevel = 0;
+  uint32_t ref = NO_NOGOOD;
+  bool redundant;
+
+  if (solved)
+    for (n = 0; n < worker->depth; n++)
+      cells[n] = worker->stack[n].i * puzzle->xsize + worker->stack[n].j;
+  else if (worker->conflictline != NO_LINE)
+    n = line_cells(worker, worker->conflictline, worker->conflictstart, cells);
+  else
+    n = nogood_cells(worker, worker->conflictnogood, UINT_MAX, cells);
+  for (k = 0; k < n; k++)
+  {
+    level = cell_level(worker, cells[k]);
+    if (level > conflictlevel)
+      conflictlevel = level;
+  }
+  if (conflictlevel <= count_fixed(worker))
+    return false;
+
+  p = conflictlevel < worker->depth ? worker->stack[conflictlevel].trailsize : mpicture->trailsize;
+  while (true)
+  {
+    for (k = 0; k < n; k++)
+    {
+      cell = cells[k];
+      if (seen[cell])
+        continue;
+      level = cell_level(worker, cell);
+      if (level == 0)
+        continue;
+      seen[cell] = 1;
+      if (level == conflictlevel)
+      {
+        counter++;
+        continue;
+      }
+      literals[nliterals++] = make_literal(cell, get_cell(mpicture, cell / puzzle->xsize, cell % puzzle->xsize) == X);
+    }
+    do
+      cell = mpicture->trail[--p];
+    while (!seen[cell]);
+    seen[cell] = 0;
+    if (--counter == 0)
+      break;
+    n = reason_cells(worker, find_reason(worker, p), cell, cells);
+  }
+  literals[0] = make_literal(cell, get_cell(mpicture, cell / puzzle->xsize, cell % puzzle->xsize) == X);
+
+  // Leave out the cells that follow from the other ones. Put the one from
+  // the latest level second, so that it gets watched.
+  for (k = n = 1; k < nliterals; k++)
+  {
+    cell = literals[k] / 2;
+    reason = find_reason(worker, mpicture->position[cell]);
+    redundant = reason->line != NO_LINE || reason->nogood != NO_NOGOOD;
+    m = redundant ? reason_cells(worker, reason, cell, cells) : 0;
+    for (j = 0; j < m && redundant; j++)
+      redundant = seen[cells[j]];
+    if (redundant)
+      continue;
+    tmp = literals[k];
+    literals[k] = literals[n];
+    literals[n++] = tmp;
+    level = cell_level(worker, cell);
+    if (level > backlevel)
+    {
+      backlevel = level;
+      literals[n - 1] = literals[1];
+      literals[1] = tmp;
+    }
+  }
+  for (k = 1; k < nliterals; k++)
+    seen[literals[k] / 2] = 0;
+  nliterals = n;
+
+  pthread_mutex_lock(&worker->lock);
+  for (top = 0; top < worker->depth && worker->stack[top].flipped; top++)
+    ;
+  if (top >= conflictlevel)
+  {
+    pthread_mutex_unlock(&worker->lock);
+    return false;
+  }
+  if (backlevel > top)
+    top = backlevel;
+  if (worker->depth - top > 1)
+    worker->backjumps++;
+  worker->depth = top;
+  pthread_mutex_unlock(&worker->lock);
+  undo_search(worker, worker->stack[top].trailsize, worker->stack[top].boundstrailsize);
+
+  if (nliterals > 1)
+    ref = keep_nogood(worker, literals, nliterals, solved);
+  worker->learned++;
+  cell = literals[0] / 2;
+  *ri = cell / puzzle->xsize;
+  *rj = cell % puzzle->xsize;
+  *rvalue = (literals[0] & 1) ? O : X;
+  *rnogood = ref;
+  return true;
+}
+
+static bool steal(Worker *thief, bool *ok)
+// Take over the oldest untried alternative of another worker:
+// replay the decisions leading to it, then make the other choice.
+// Return false if no other worker had anything to give away.
+//
+// The thief has nogoods of its own, so some of the cells may be known by the
+// time their decisions are replayed. If one of them is known to be the other
+// way round, there's nothing to explore, and the alternative is given up
+// right away.
+{
+  Solver *solver = thief->solver;
+  Picture *mpicture = thief->picture;
+  Worker *victim = NULL;
+  Decision *top;
+  unsigned int v, k = 0, depth;
+  bit value = Q;
+
+  for (v = 1; v < solver->nworkers; v++)
+  {
+    victim = solver->workers[(thief->id + v) % solver->nworkers];
+    pthread_mutex_lock(&victim->lock);
+    for (k = 0; k < victim->depth && victim->stack[k].flipped; k++)
+      ;
+    if (k < victim->depth)
+      break;
+    pthread_mutex_unlock(&victim->lock);
+  }
+  if (v == solver->nworkers)
+    return false;
+  victim->stack[k].flipped = true;
+  atomic_fetch_add(&solver->busy, 1);
+  depth = k + 1;
+  memcpy(thief->stack, victim->stack, depth * sizeof(Decision));
+  pthread_mutex_unlock(&victim->lock);
+
+  // None of the replayed decisions is to be tried the other way round here.
+  thief->stack[depth - 1].value = -thief->stack[depth - 1].value;
+  undo_search(thief, thief->roottrailsize, thief->rootboundstrailsize);
+  *ok = true;
+  for (k = 0; k < depth && *ok; k++)
+  {
+    top = thief->stack + k;
+    top->flipped = true;
+    top->trailsize = mpicture->trailsize;
+    top->boundstrailsize = mpicture->boundstrailsize;
+    value = get_cell(mpicture, top->i, top->j);
+    if (value != Q)
+    {
+      if (value != top->value)
+        break;
+      continue;
+    }
+    mpicture->serial++;
+    push_reason(thief, mpicture->trailsize, NO_LINE, NO_NOGOOD);
+    set_cell(mpicture, top->i, top->j, top->value);
+    *ok = shake(thief);
+  }
+  if (value != Q && k < depth)
+  {
+    undo_search(thief, thief->roottrailsize, thief->rootboundstrailsize);
+    atomic_fetch_sub(&solver->busy, 1);
+    return false;
+  }
+  pthread_mutex_lock(&thief->lock);
+  thief->depth = k;
+  pthread_mutex_unlock(&thief->lock);
+  if (k > thief->maxdepth)
+    thief->maxdepth = k;
+  return true;
+}
+
+static bool found_solution(Worker *worker)
+// Count the solution the worker has just found.
+// Return true if enough solutions were found, and the search is over.
+{
+  Solver *solver = worker->solver;
+  unsigned int k = atomic_fetch_add(&solver->nsolutions, 1);
+
+  if (k + 1 < solver->maxsolutions)
+  {
+    solver->solutions[k] = clone_picture(worker->picture);
+    return false;
+  }
+  if (!atomic_exchange(&solver->done, true))
+    solver->winner = worker;
+  return true;
+}
+
+static void *search(void *arg)
+// Explore the search tree depth-first, guessing one cell at a time.
+//
+// Decisions are kept on an explicit stack. Every cell set (and every change
+// of line bounds) is recorded in the trail, so that a failed guess can be
+// undone instead of working on a copy of the picture.
+// After a contradiction, the search doesn't just try the other value of the
+// latest guess: it learns a nogood, and goes back as far as that allows (see
+// learn()). Nogoods are checked whenever cells are set.
+// A worker that runs out of work steals it from the other ones.
+// Only the part of the picture in focus is searched (see backtrack()).
+{
+  static const struct timespec pause = { 0, 100000 };
+  Worker *worker = arg;
+  Solver *solver = worker->solver;
+  Picture *mpicture = worker->picture;
+  Decision *top;
+  unsigned int i, j, line;
+  uint32_t nogood;
+  bit value;
+  bool ok = true, solved;
+
+  while (!atomic_load(&solver->done))
+  {
+    if (!worker->busy)
+    {
+      if (atomic_load(&solver->busy) == 0)
+        break;
+      worker->busy = steal(worker, &ok);
+      if (!worker->busy)
+      {
+        should_stop(worker); // keep an eye on the clock while waiting
+        nanosleep(&pause, NULL);
+      }
+      continue;
+    }
+    solved = false;
+    if (ok && mpicture->counter <= solver->outside)
+    {
+      line = find_bad_line(worker->puzzle, mpicture->filled, mpicture->empty, mpicture->cfilled, mpicture->cempty);
+      if (line == NO_LINE && found_solution(worker))
+        break;
+      solved = line == NO_LINE;
+      worker->conflictline = line;
+      worker->conflictstart = mpicture->trailsize;
+      ok = false;
+    }
+    if (ok)
+    {
+      choose_cell(worker, &i, &j, &value);
+      nogood = NO_NOGOOD;
+      pthread_mutex_lock(&worker->lock);
+      top = worker->stack + worker->depth++;
+      top->i = i;
+      top->j = j;
+      top->value = value;
+      top->flipped = false;
+      top->trailsize = mpicture->trailsize;
+      top->boundstrailsize = mpicture->boundstrailsize;
+      pthread_mutex_unlock(&worker->lock);
+      if (worker->depth > worker->maxdepth)
+        worker->maxdepth = worker->depth;
+    }
+    else
+    {
+      worker->failures++;
+      if (!learn(worker, solved, &i, &j, &value, &nogood))
+      {
+        pthread_mutex_lock(&worker->lock);
+        worker->depth = 0; // the guesses still on the stack lead nowhere
+        pthread_mutex_unlock(&worker->lock);
+        worker->busy = false;
+        atomic_fetch_sub(&solver->busy, 1);
+        continue;
+      }
+    }
+    if (solver->maxnodes > 0 && atomic_fetch_add(&solver->nodes, 1) >= solver->maxnodes)
+    {
+      stop(solver);
+      break;
+    }
+    mpicture->serial++;
+    worker->nodes++;
+    push_reason(worker, mpicture->trailsize, NO_LINE, nogood);
+    set_cell(mpicture, i, j, value);
+    ok = shake(worker);
+  }
+  return NULL;
+}
+
+Solver *alloc_solver(unsigned int nthreads)
+{
+  unsigned int k;
+  Solver *tmp = alloc(sizeof(Solver));
+  tmp->nworkers = nthreads;
+  tmp->maxsolutions = 1;
+  tmp->workers = alloc(nthreads * sizeof(Worker*));
+  for (k = 0; k < nthreads; k++)
+    tmp->workers[k] = alloc_worker(k, tmp);
+  return tmp;
+}
+
+void free_solver(Solver *solver)
+{
+  unsigned int k;
+  for (k = 0; k < solver->nworkers; k++)
+    free_worker(solver->workers[k]);
+  free(solver->workers);
+  for (k = 0; k < 2; k++)
+    if (solver->solutions[k] != NULL)
+      free_picture(solver->solutions[k]);
+  if (solver->storekey != NULL)
+    free_store_key(solver->storekey);
+  free(solver);
+}
+
+void setup_solver(Solver *solver, const Puzzle *puzzle)
+// Get the solver ready for the puzzle, starting with an empty picture.
+{
+  unsigned int k;
+  for (k = 0; k < solver->nworkers; k++)
+    setup_worker(solver->workers[k], puzzle, LINE_CACHE_SIZE / solver->nworkers);
+  for (k = 0; k < 2; k++)
+  {
+    if (solver->solutions[k] != NULL)
+      free_picture(solver->solutions[k]);
+    solver->solutions[k] = NULL;
+  }
+  if (solver->storekey != NULL)
+    free_store_key(solver->storekey);
+  solver->storekey = NULL;
+  solver->storehits = solver->storemisses = 0;
+  solver->ncomponents = 0;
+  atomic_store(&solver->nsolutions, 0);
+  atomic_store(&solver->nodes, 0);
+  atomic_store(&solver->stopped, false);
+  atomic_store(&solver->done, false);
+  solver->started = solver->lastreport = get_time();
+  solver->deadline = solver->timelimit > 0 ? solver->started + solver->timelimit : 0;
+  solver->nextreport = solver->started + solver->progressinterval;
+  solver->lastfingercounter = solver->lastnodes = 0;
+  solver->phase = "lines";
+  solver->puzzle = puzzle;
+  solver->picture = solver->workers[0]->picture = alloc_picture(puzzle);
+  publish_progress(solver->workers[0]);
+  solver->preliminarytime = solver->shaketime = solver->probetime = solver->backtracktime = 0;
+}
+
+bool solve_lines(Solver *solver)
+// Solve as much as possible without guessing.
+// Return false if the puzzle turned out to be inconsistent.
+{
+  double t0, t1, t2;
+
+  t0 = get_time();
+  preliminary_shake(solver->picture);
+  t1 = get_time();
+  shake(solver->workers[0]);
+  t2 = get_time();
+  solver->preliminarytime = t1 - t0;
+  solver->shaketime = t2 - t1;
+  return check_consistency(solver->puzzle, solver->picture->filled, solver->picture->empty, solver->picture->cfilled, solver->picture->cempty);
+}
+
+static unsigned int find_root(unsigned int *parent, unsigned int n)
+{
+  while (parent[n] != n)
+    n = parent[n] = parent[parent[n]];
+  return n;
+}
+
+static int compare_keys(const void *a, const void *b)
+{
+  uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+  return (x > y) - (x < y);
+}
+
+static unsigned int find_components(Solver *solver, unsigned int *sizes)
+// Split the unknown cells into parts that share no line with unknown cells.
+// Lines that are solved already (or whose unknown cells are all in one part)
+// tie nothing together, so a guess in one part has no effect on the others,
+// and each part can be searched on its own.
+// Number the parts from the smallest to the largest, put the part of every
+// line with unknown cells in solver->linecomponent, and the number of unknown
+// cells of every part in sizes.
+// Return the number of parts; if there are no unknown cells, that's one empty part.
+{
+  const Puzzle *puzzle = solver->puzzle;
+  const Picture *mpicture = solver->picture;
+  const uint64_t *filled, *empty;
+  uint64_t unknown, *keys;
+  unsigned int *parent, *count;
+  unsigned int i, j, w, line, n = 0;
+
+  parent = alloc(puzzle->xpysize * sizeof(unsigned int));
+  count = alloc(puzzle->xpysize * sizeof(unsigned int));
+  keys = alloc(puzzle->xpysize * sizeof(uint64_t));
+  for (line = 0; line < puzzle->xpysize; line++)
+    parent[line] = line;
+  for (i = 0; i < puzzle->ysize; i++)
+  {
+    if (mpicture->linecounter[i] == 0)
+      continue;
+    filled = mpicture->filled + (size_t)i * puzzle->rowwords;
+    empty = mpicture->empty + (size_t)i * puzzle->rowwords;
+    for (w = 0; w < puzzle->rowwords; w++)
+    for (unknown = ~(filled[w] | empty[w]); unknown != 0; unknown &= unknown - 1)
+    {
+      j = w * WORD_BITS + __builtin_ctzll(unknown);
+      if (j >= puzzle->xsize)
+        break;
+      parent[find_root(parent, i)] = find_root(parent, puzzle->ysize + j);
+    }
+  }
+  for (i = 0; i < puzzle->ysize; i++)
+    count[find_root(parent, i)] += mpicture->linecounter[i];
+  for (line = 0; line < puzzle->xpysize; line++)
+    if (parent[line] == line && count[line] > 0)
+      keys[n++] = (uint64_t) count[line] << 32 | line;
+  qsort(keys, n, sizeof(uint64_t), compare_keys);
+  for (i = 0; i < n; i++)
+  {
+    sizes[i] = keys[i] >> 32;
+    count[(uint32_t) keys[i]] = i;
+  }
+  for (line = 0; line < puzzle->xpysize; line++)
+    solver->linecomponent[line] = mpicture->linecounter[line] > 0 ? count[find_root(parent, line)] : UINT_MAX;
+  if (n == 0)
+    sizes[n++] = 0;
+  free(parent);
+  free(count);
+  free(keys);
+  return n;
+}
+
+static void merge_components(Picture *dst, const Picture *src, const unsigned int *linecomponent, unsigned int first, unsigned int last)
+// Fill in the unknown cells of the parts of the picture from first to
+// last - 1, as they are in src.
+{
+  const Puzzle *puzzle = dst->puzzle;
+  unsigned int i, j;
+
+  for (i = 0; i < puzzle->ysize; i++)
+  {
+    if (dst->linecounter[i] == 0 || linecomponent[i] < first || linecomponent[i] >= last)
+      continue;
+    for (j = 0; j < puzzle->xsize; j++)
+      if (get_cell(dst, i, j) == Q)
+        set_cell(dst, i, j, get_cell(src, i, j));
+  }
+}
+
+static unsigned int search_component(Solver *solver)
+// Search the part of the picture that is in focus, using all the workers.
+// Return how many solutions were found (at most solver->maxsolutions).
+// As with found_solution(), the last one is in the picture of the winner,
+// and the one before, if any, is kept aside.
+{
+  pthread_t *threads;
+  Worker **workers = solver->workers;
+  unsigned int k, n = solver->nworkers;
+
+  for (k = 0; k < n; k++)
+  {
+    workers[k]->roottrailsize = workers[k]->picture->trailsize;
+    workers[k]->rootboundstrailsize = workers[k]->picture->boundstrailsize;
+    workers[k]->busy = k == 0;
+    workers[k]->depth = 0;
+    workers[k]->nreasons = 0;
+    workers[k]->nogoodhead = workers[k]->roottrailsize;
+    clear_nogood_base(workers[k]->nogoods);
+    publish_progress(workers[k]);
+  }
+  solver->winner = NULL;
+  atomic_store(&solver->nsolutions, 0);
+  atomic_store(&solver->done, false);
+  atomic_store(&solver->busy, 1);
+
+  threads = alloc(n * sizeof(pthread_t));
+  for (k = 1; k < n; k++)
+    if (pthread_create(threads + k, NULL, search, workers[k]) != 0)
+      break; // make do with fewer threads; the idle workers have nothing to steal
+  n = k;
+  search(workers[0]);
+  for (k = 1; k < n; k++)
+    pthread_join(threads[k], NULL);
+  free(threads);
+
+  n = atomic_load(&solver->nsolutions);
+  return n < solver->maxsolutions ? n : solver->maxsolutions;
+}
+
+bool backtrack(Solver *solver)
+// Narrow down the picture by probing,
+// then search for a solution, using all the workers.
+// If one is found, put it in the picture of the first worker.
+//
+// The unknown cells are split into independent parts first (see
+// find_components()), which are searched one after another, so that a part
+// with no solution is never searched again for every solution of the others.
+// Once a part is solved, it's filled in in the pictures of all the workers.
+//
+// When checking uniqueness, one solution of every part is found first (unless
+// there is only one part). Only then are the parts searched again for a
+// second solution, from the smallest one up; the second solution of the
+// puzzle is the first one with that part changed. This way, finding a second
+// solution of a part proves that the puzzle has more than one, even if the
+// solver gives up right after.
+//
+// If the solver gives up before every part is solved, the picture of the
+// first worker is taken back to what it was before the search.
+{
+  Worker **workers = solver->workers;
+  Picture *mpicture = solver->picture;
+  Picture *first; // the first solution, while looking for a second one
+  const Picture *source;
+  unsigned int *sizes, *roots;
+  unsigned int k, c, m, n = 0, maxsolutions = solver->maxsolutions, outside;
+  double t0 = get_time();
+  bool ok;
+
+  solver->phase = "probing";
+  ok = probe(solver);
+  solver->probetime = get_time() - t0;
+  if (!ok || atomic_load(&solver->stopped))
+    return false;
+
+  t0 = get_time();
+  roots = alloc(2 * solver->nworkers * sizeof(unsigned int));
+  for (k = 0; k < solver->nworkers; k++)
+  {
+    if (k > 0)
+    {
+      if (workers[k]->picture != NULL)
+        free_picture(workers[k]->picture);
+      workers[k]->picture = clone_picture(mpicture);
+    }
+    roots[2 * k] = workers[k]->picture->trailsize;
+    roots[2 * k + 1] = workers[k]->picture->boundstrailsize;
+    start_search(workers[k]);
+    start_learning(workers[k], NOGOOD_BASE_SIZE / solver->nworkers);
+  }
+  solver->linecomponent = alloc(solver->puzzle->xpysize * sizeof(unsigned int));
+  sizes = alloc(solver->puzzle->xpysize * sizeof(unsigned int));
+  m = solver->ncomponents = find_components(solver, sizes);
+  solver->phase = "search";
+
+  if (m > 1)
+    solver->maxsolutions = 1;
+  for (solver->focus = 0; solver->focus < m && !atomic_load(&solver->stopped); solver->focus++)
+  {
+    solver->outside = mpicture->counter - sizes[solver->focus];
+    n = search_component(solver);
+    if (n == 0)
+      break;
+    source = solver->solutions[0] != NULL ? solver->solutions[0] : solver->winner->picture;
+    if (n > 1)
+      solver->solutions[1] = clone_picture(solver->winner->picture);
+    for (k = 0; k < solver->nworkers; k++)
+    {
+      if (workers[k]->picture == source)
+        continue;
+      undo(workers[k]->picture, workers[k]->roottrailsize, workers[k]->rootboundstrailsize);
+      merge_components(workers[k]->picture, source, solver->linecomponent, solver->focus, solver->focus + 1);
+    }
+    if (solver->solutions[0] != NULL)
+      free_picture(solver->solutions[0]);
+    solver->solutions[0] = NULL;
+  }
+
+  if (solver->focus < m)
+  {
+    undo(mpicture, roots[0], roots[1]);
+    n = 0;
+  }
+  else if (n == 1 && maxsolutions > 1 && m > 1)
+  {
+    first = clone_picture(mpicture);
+    for (k = 0; k < solver->nworkers; k++)
+      undo(workers[k]->picture, roots[2 * k], roots[2 * k + 1]);
+    solver->maxsolutions = 2;
+    outside = mpicture->counter;
+    for (c = 0; c < m && !atomic_load(&solver->stopped); c++)
+    {
+      outside -= sizes[c];
+      solver->focus = c;
+      solver->outside = outside;
+      n = search_component(solver);
+      if (n > 1)
+      {
+        solver->solutions[1] = clone_picture(solver->winner->picture);
+        merge_components(solver->solutions[1], first, solver->linecomponent, c + 1, m);
+        merge_components(solver->solutions[0], first, solver->linecomponent, c + 1, m);
+        break;
+      }
+      if (solver->solutions[0] != NULL)
+        free_picture(solver->solutions[0]);
+      solver->solutions[0] = NULL;
+      for (k = 0; k < solver->nworkers; k++)
+      {
+        undo(workers[k]->picture, workers[k]->roottrailsize, workers[k]->rootboundstrailsize);
+        merge_components(workers[k]->picture, first, solver->linecomponent, c, c + 1);
+      }
+    }
+    source = n > 1 ? solver->solutions[0] : first;
+    undo(mpicture, roots[0], roots[1]);
+    merge_components(mpicture, source, solver->linecomponent, 0, m);
+    if (solver->solutions[0] != NULL)
+      free_picture(solver->solutions[0]);
+    solver->solutions[0] = NULL;
+    free_picture(first);
+    n = n < 2 ? 1 : 2;
+  }
+  atomic_store(&solver->nsolutions, n);
+  solver->maxsolutions = maxsolutions;
+  for (k = 0; k < solver->nworkers; k++)
+    stop_learning(workers[k]);
+  free(solver->linecomponent);
+  solver->linecomponent = NULL;
+  free(sizes);
+  free(roots);
+  solver->backtracktime = get_time() - t0;
+  return n > 0;
+}
+
+static const StoreKey *get_store_key(Solver *solver)
+{
+  if (solver->storekey == NULL)
+    solver->storekey = make_store_key(solver->puzzle);
+  return solver->storekey;
+}
+
+static void unpack_picture(const Picture *mpicture, bit *cells);
+
+int recall_solution(Solver *solver)
+// Look the puzzle up in the store, if there's one.
+// Return -1 if it's not there.
+// Otherwise, return 0 if the puzzle is inconsistent,
+// or 1 if it's solved, filling in the picture.
+// Solutions are checked against the clues, in case the store is damaged.
+{
+  const Puzzle *puzzle = solver->puzzle;
+  Picture *mpicture = solver->picture;
+  unsigned int i, j;
+  bit *cells;
+  int rc;
+
+  if (solver->store == NULL)
+    return -1;
+  cells = alloc(puzzle->vsize * sizeof(bit));
+  rc = lookup_store(solver->store, get_store_key(solver), solver->maxsolutions > 1, cells);
+  if (rc > 0 && !check_cells(puzzle, cells))
+    rc = -1;
+  if (rc > 0)
+  {
+    for (i = 0; i < puzzle->ysize; i++)
+    for (j = 0; j < puzzle->xsize; j++)
+      put_plane(mpicture, i, j, cells[(size_t) i * puzzle->xsize + j]);
+    memset(mpicture->linecounter, 0, puzzle->xpysize * sizeof(unsigned int));
+    mpicture->counter = 0;
+  }
+  free(cells);
+  if (rc < 0)
+    solver->storemisses++;
+  else
+    solver->storehits++;
+  return rc;
+}
+
+void remember_solution(Solver *solver, bool solved, bool unique)
+// Put the solution in the store, if there's one;
+// or, unless solved, the fact that the puzzle is inconsistent.
+// If unique, the solution is known to be the only one.
+{
+  bit *cells = NULL;
+
+  if (solver->store == NULL)
+    return;
+  if (solved)
+  {
+    cells = alloc(solver->puzzle->vsize * sizeof(bit));
+    unpack_picture(solver->picture, cells);
+  }
+  save_store(solver->store, get_store_key(solver), unique, cells);
+  free(cells);
+}
+
+static void unpack_picture(const Picture *mpicture, bit *cells)
+// Unpack the cells, row by row.
+{
+  const Puzzle *puzzle = mpicture->puzzle;
+  unsigned int i, j;
+
+  for (i = 0; i < puzzle->ysize; i++)
+  for (j = 0; j < puzzle->xsize; j++)
+    *cells++ = get_cell(mpicture, i, j);
+}
+
+void get_picture(const Solver *solver, bit *cells)
+{
+  unpack_picture(solver->picture, cells);
+}
+
+void get_second_picture(const Solver *solver, bit *cells)
+{
+  assert(solver->solutions[1] != NULL);
+  unpack_picture(solver->solutions[1], cells);
+}
+
+void get_stats(const Solver *solver, Stats *stats)
+{
+  unsigned int k;
+  Worker *worker;
+
+  memset(stats, 0, sizeof *stats);
+  stats->cache = solver->workers[0]->linecache != NULL;
+  stats->stopped = atomic_load(&solver->stopped);
+  stats->components = solver->ncomponents;
+  stats->store = solver->store != NULL;
+  stats->storehits = solver->storehits;
+  stats->storemisses = solver->storemisses;
+  stats->preliminary_shake_time = solver->preliminarytime;
+  stats->shake_time = solver->shaketime;
+  stats->probe_time = solver->probetime;
+  stats->backtrack_time = solver->backtracktime;
+  for (k = 0; k < solver->nworkers; k++)
+  {
+    worker = solver->workers[k];
+    stats->fingercounter += worker->fingercounter;
+    stats->linesolves += worker->linesolves;
+    stats->cells += worker->cells;
+    stats->pushes += worker->queue->pushes;
+    stats->pops += worker->queue->pops;
+    stats->probes += worker->probes;
+    stats->nodes += worker->nodes;
+    stats->failures += worker->failures;
+    stats->learned += worker->learned;
+    stats->backjumps += worker->backjumps;
+    if (worker->maxdepth > stats->maxdepth)
+      stats->maxdepth = worker->maxdepth;
+    if (worker->linecache != NULL)
+    {
+      stats->cachehits += worker->linecache->hits;
+      stats->cachemisses += worker->linecache->misses;
+    }
+  }
+}
+
+/* vim:set ts=2 sts=2 sw=2 et: */
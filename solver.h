@@ -0,0 +1,45 @@
+/* Copyright © 2003-2026 Jakub Wilk <jwilk@jwilk.net>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef NONOGRAM_SOLVER_H
+#define NONOGRAM_SOLVER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "nonogram.h"
+
+Solver *alloc_solver(unsigned int);
+void free_solver(Solver*);
+void setup_solver(Solver*, const Puzzle*);
+bool solve_lines(Solver*);
+bool backtrack(Solver*);
+int recall_solution(Solver*);
+void remember_solution(Solver*, bool, bool);
+void get_stats(const Solver*, Stats*);
+bool check_consistency(const Puzzle*, const uint64_t*, const uint64_t*, const uint64_t*, const uint64_t*);
+bool check_cells(const Puzzle*, const bit*);
+void get_picture(const Solver*, bit*);
+void get_second_picture(const Solver*, bit*);
+
+#endif
+
+/* vim:set ts=2 sts=2 sw=2 et: */
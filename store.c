@@ -0,0 +1,328 @@
+/* Copyright © 2026 Jakub Wilk <jwilk@jwilk.net>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the “Software”), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED “AS IS”, WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Persistent store of solutions, which processes can share.
+//
+// Puzzles that are mirror images, rotations or transpositions of each other
+// share an entry: of the 8 variants of the clues, the least one (in
+// lexicographic order) is the canonical form, and the solution is stored in
+// that form too.
+//
+// Each entry is a file named after the hash of the canonical form, in
+// a subdirectory named after its first byte. It consists of a header of
+// four 32-bit words (the magic number, flags, the size of the canonical form,
+// and 0); the canonical form itself, as 16-bit words, to tell hash collisions
+// apart; and, if the puzzle was solved, the solution in the canonical form,
+// one bit per cell, row by row. Numbers are in the native byte order.
+// Entries are written to a temporary file, which is then renamed,
+// so that readers never see a partial one. They are created readable by
+// everyone, as far as the umask allows.
+
+#include "autoconf.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
+#include "memory.h"
+#include "nonogram.h"
+#include "store.h"
+
+#define STORE_MAGIC UINT32_C(0x4E4F4E31)
+#define STORE_SOLVED 1 // the puzzle has a solution, which follows
+#define STORE_UNIQUE 2 // and it's the only one
+#define HEADER_SIZE (4 * sizeof (uint32_t))
+#define TMP_ATTEMPTS 100 // names to try for a temporary file
+
+static atomic_uint gtmpcounter; // makes temporary file names unique within the process
+
+Store *open_store(const char *path)
+// Open the store in the directory, creating it if needed.
+// Return NULL (setting errno) if that's not possible.
+{
+  Store *tmp;
+  struct stat st;
+
+  if (mkdir(path, 0777) < 0 && errno != EEXIST)
+    return NULL;
+  if (stat(path, &st) < 0)
+    return NULL;
+  if (!S_ISDIR(st.st_mode))
+  {
+    errno = ENOTDIR;
+    return NULL;
+  }
+  tmp = alloc(sizeof(Store));
+  tmp->path = alloc(strlen(path) + 1);
+  strcpy(tmp->path, path);
+  return tmp;
+}
+
+void free_store(Store *store)
+{
+  free(store->path);
+  free(store);
+}
+
+static uint16_t *put_line(uint16_t *p, const Puzzle *puzzle, unsigned int line, bool reverse)
+// Put the number of blocks of the line, and their lengths, possibly in reverse order.
+{
+  const Clue *clues = line_clues(puzzle, line);
+  unsigned int n = puzzle->blockcount[line], k;
+
+  *p++ = n;
+  for (k = 0; k < n; k++)
+    *p++ = clues[reverse ? n - 1 - k : k];
+  return p;
+}
+
+static void put_variant(uint16_t *p, const Puzzle *puzzle, bool transposed, bool fliprows, bool flipcolumns)
+// Put the clues of the puzzle flipped upside down (if fliprows),
+// flipped left to right (if flipcolumns), and then transposed (if transposed).
+{
+  unsigned int xsize = puzzle->xsize, ysize = puzzle->ysize, k;
+
+  *p++ = transposed ? ysize : xsize;
+  *p++ = transposed ? xsize : ysize;
+  if (!transposed)
+  {
+    for (k = 0; k < ysize; k++)
+      p = put_line(p, puzzle, fliprows ? ysize - 1 - k : k, flipcolumns);
+    for (k = 0; k < xsize; k++)
+      p = put_line(p, puzzle, ysize + (flipcolumns ? xsize - 1 - k : k), fliprows);
+  }
+  else
+  {
+    for (k = 0; k < xsize; k++)
+      p = put_line(p, puzzle, ysize + (flipcolumns ? xsize - 1 - k : k), fliprows);
+    for (k = 0; k < ysize; k++)
+      p = put_line(p, puzzle, fliprows ? ysize - 1 - k : k, flipcolumns);
+  }
+}
+
+StoreKey *make_store_key(const Puzzle *puzzle)
+// Put the clues in the canonical form, and hash them.
+{
+  StoreKey *tmp = alloc(sizeof(StoreKey));
+  uint16_t *variant, *swap;
+  unsigned int t;
+  size_t k;
+  uint64_t h = UINT64_C(0xCBF29CE484222325);
+
+  tmp->size = 2 + puzzle->xpysize + puzzle->clueoffset[puzzle->xpysize];
+  tmp->data = alloc(tmp->size * sizeof(uint16_t));
+  variant = alloc(tmp->size * sizeof(uint16_t));
+  put_variant(tmp->data, puzzle, false, false, false);
+  for (t = 1; t < 8; t++)
+  {
+    put_variant(variant, puzzle, t & 4, t & 2, t & 1);
+    for (k = 0; k < tmp->size && variant[k] == tmp->data[k]; k++)
+      ;
+    if (k == tmp->size || variant[k] > tmp->data[k])
+      continue;
+    swap = tmp->data;
+    tmp->data = variant;
+    variant = swap;
+    tmp->transposed = t & 4;
+    tmp->fliprows = t & 2;
+    tmp->flipcolumns = t & 1;
+  }
+  free(variant);
+  tmp->xsize = tmp->data[0];
+  tmp->ysize = tmp->data[1];
+  for (k = 0; k < tmp->size; k++)
+    h = (h ^ tmp->data[k]) * UINT64_C(0x100000001B3);
+  tmp->hash = h;
+  return tmp;
+}
+
+void free_store_key(StoreKey *key)
+{
+  free(key->data);
+  free(key);
+}
+
+static size_t map_cell(const StoreKey *key, unsigned int i, unsigned int j)
+// Find where the cell of the canonical form is in the puzzle, row by row.
+{
+  unsigned int xsize = key->transposed ? key->ysize : key->xsize;
+  unsigned int ysize = key->transposed ? key->xsize : key->ysize;
+  unsigned int y = key->transposed ? j : i, x = key->transposed ? i : j;
+
+  if (key->fliprows)
+    y = ysize - 1 - y;
+  if (key->flipcolumns)
+    x = xsize - 1 - x;
+  return (size_t) y * xsize + x;
+}
+
+static size_t entry_size(const StoreKey *key, bool solved)
+{
+  size_t size = HEADER_SIZE + key->size * sizeof(uint16_t);
+  if (solved)
+    size += ((size_t) key->xsize * key->ysize + 7) / 8;
+  return size;
+}
+
+static char *entry_path(const Store *store, const StoreKey *key, bool directory)
+{
+  size_t size = strlen(store->path) + 24;
+  char *tmp = alloc(size);
+
+  if (directory)
+    snprintf(tmp, size, "%s/%02x", store->path, (unsigned int)(key->hash >> 56));
+  else
+    snprintf(tmp, size, "%s/%02x/%014jx", store->path, (unsigned int)(key->hash >> 56),
+      (uintmax_t)(key->hash & UINT64_C(0xFFFFFFFFFFFFFF)));
+  return tmp;
+}
+
+static int check_entry(const StoreKey *key, bool unique, const unsigned char *data, size_t size, bit *cells)
+// Check that the entry is for the puzzle, and has what we're looking for.
+// Return -1 if it doesn't.
+// Otherwise, return 0 if the puzzle is inconsistent,
+// or 1 if it's solved, copying the solution to cells.
+{
+  uint32_t header[4];
+  const unsigned char *bits;
+  unsigned int i, j;
+  size_t n;
+
+  if (size < HEADER_SIZE)
+    return -1;
+  memcpy(header, data, HEADER_SIZE);
+  if (header[0] != STORE_MAGIC || header[2] != key->size || header[3] != 0)
+    return -1;
+  if (size != entry_size(key, header[1] & STORE_SOLVED))
+    return -1;
+  if (memcmp(data + HEADER_SIZE, key->data, key->size * sizeof(uint16_t)) != 0)
+    return -1;
+  if (!(header[1] & STORE_SOLVED))
+    return 0;
+  if (unique && !(header[1] & STORE_UNIQUE))
+    return -1;
+  bits = data + HEADER_SIZE + key->size * sizeof(uint16_t);
+  for (i = 0, n = 0; i < key->ysize; i++)
+  for (j = 0; j < key->xsize; j++, n++)
+    cells[map_cell(key, i, j)] = (bits[n / 8] >> (n % 8)) & 1 ? X : O;
+  return 1;
+}
+
+int lookup_store(const Store *store, const StoreKey *key, bool unique, bit *cells)
+// Look the puzzle up. If unique, only a solution known to be unique will do.
+// Return -1 if it's not there.
+// Otherwise, return 0 if the puzzle is inconsistent,
+// or 1 if it's solved, copying the solution to cells.
+{
+  char *path;
+  struct stat st;
+  unsigned char *data;
+  int fd, rc = -1;
+
+  if (key->size > UINT32_MAX)
+    return -1; // the header has no room for that
+  path = entry_path(store, key, false);
+  fd = open(path, O_RDONLY);
+  free(path);
+  if (fd < 0)
+    return -1;
+  if (fstat(fd, &st) == 0 && st.st_size > 0 && (off_t)(size_t) st.st_size == st.st_size)
+  {
+#ifdef HAVE_MMAP
+    data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED)
+    {
+      rc = check_entry(key, unique, data, st.st_size, cells);
+      munmap(data, st.st_size);
+    }
+#else
+    data = alloc(st.st_size);
+    if (read(fd, data, st.st_size) == st.st_size)
+      rc = check_entry(key, unique, data, st.st_size, cells);
+    free(data);
+#endif
+  }
+  close(fd);
+  return rc;
+}
+
+void save_store(const Store *store, const StoreKey *key, bool unique, const bit *cells)
+// Remember the solution, or, if cells is NULL, that the puzzle is inconsistent.
+// If unique, the solution is known to be the only one.
+// Failures are ignored; it's only a cache.
+{
+  size_t size = entry_size(key, cells != NULL), n;
+  unsigned char *data, *bits;
+  uint32_t header[4] = { STORE_MAGIC, 0, key->size, 0 };
+  char *directory, *path, *tmppath;
+  unsigned int i, j, k;
+  int fd = -1;
+  bool ok;
+
+  if (key->size > UINT32_MAX)
+    return;
+  data = alloc(size);
+  if (cells != NULL)
+    header[1] = STORE_SOLVED | (unique ? STORE_UNIQUE : 0);
+  memcpy(data, header, HEADER_SIZE);
+  memcpy(data + HEADER_SIZE, key->data, key->size * sizeof(uint16_t));
+  bits = data + HEADER_SIZE + key->size * sizeof(uint16_t);
+  if (cells != NULL)
+    for (i = 0, n = 0; i < key->ysize; i++)
+    for (j = 0; j < key->xsize; j++, n++)
+      if (cells[map_cell(key, i, j)] == X)
+        bits[n / 8] |= 1 << (n % 8);
+
+  directory = entry_path(store, key, true);
+  path = entry_path(store, key, false);
+  tmppath = alloc(strlen(directory) + 48);
+  mkdir(directory, 0777);
+  // Not mkstemp(), which would make the entry private.
+  for (k = 0; k < TMP_ATTEMPTS && fd < 0; k++)
+  {
+    sprintf(tmppath, "%s/.tmp.%ld.%u", directory, (long) getpid(), atomic_fetch_add(&gtmpcounter, 1));
+    fd = open(tmppath, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd < 0 && errno != EEXIST)
+      break;
+  }
+  if (fd >= 0)
+  {
+    ok = write(fd, data, size) == (ssize_t) size;
+    ok = close(fd) == 0 && ok;
+    if (!ok || rename(tmppath, path) < 0)
+      unlink(tmppath);
+  }
+  free(tmppath);
+  free(path);
+  free(directory);
+  free(data);
+}
+
+/* vim:set ts=2 sts=2 sw=2 et: */